@@ -0,0 +1,77 @@
+# Generates TUs with N chained freestanding and CRTP scope function calls for
+# every N in STAGES and measures the front end time of compiling each of them.
+# A TU with 0 stages only includes scopefn.hpp, which measures parsing the
+# header itself. GCC and Clang time reports are written next to the generated
+# sources, Clang additionally writes -ftime-trace JSON files.
+#
+# Expected variables: COMPILER, COMPILER_ID, INCLUDE_DIR, STAGES, OUTPUT_DIR
+
+cmake_minimum_required(VERSION 3.13)
+
+# Sub-second timestamps (%f) need CMake 3.23, older versions time in seconds
+if(CMAKE_VERSION VERSION_LESS 3.23)
+    set(TIMESTAMP_FORMAT "%s")
+    set(TIMESTAMP_TO_MILLISECONDS "* 1000")
+else()
+    set(TIMESTAMP_FORMAT "%s%f")
+    set(TIMESTAMP_TO_MILLISECONDS "/ 1000")
+endif()
+
+function(generate_tu FILE STAGE_COUNT)
+    file(WRITE ${FILE}
+        "#include \"scopefn.hpp\"\n"
+        "using namespace scopefn;\n"
+        "struct Counter : ScopeFunctions<Counter> { int value = 0; };\n")
+    if(STAGE_COUNT GREATER 0)
+        set(FREESTANDING "")
+        set(CRTP "")
+        foreach(I RANGE 1 ${STAGE_COUNT})
+            string(APPEND FREESTANDING
+                "        | also([](Counter& it) { it.value += ${I}; })\n"
+                "        | let([](Counter& it) { Counter next; next.value = it.value * ${I}; return next; })\n")
+            string(APPEND CRTP
+                "        .also([](Counter& it) { it.value -= ${I}; })\n"
+                "        .apply([self = &counter] { self->value++; })\n")
+        endforeach()
+        file(APPEND ${FILE}
+            "int freestanding(Counter counter)\n{\n"
+            "    return (counter\n${FREESTANDING}"
+            "        | let([](Counter& it) { return it.value; }));\n}\n"
+            "int crtp(Counter& counter)\n{\n"
+            "    return counter\n${CRTP}"
+            "        .let([](Counter& it) { return it.value; });\n}\n")
+    endif()
+endfunction()
+
+if(COMPILER_ID MATCHES "Clang")
+    set(TIME_FLAGS -ftime-report -ftime-trace)
+elseif(COMPILER_ID MATCHES "GNU")
+    set(TIME_FLAGS -ftime-report)
+endif()
+
+separate_arguments(STAGES)
+message(STATUS "stages | front end wall time")
+foreach(STAGE_COUNT ${STAGES})
+    set(SOURCE ${OUTPUT_DIR}/chain_${STAGE_COUNT}.cpp)
+    generate_tu(${SOURCE} ${STAGE_COUNT})
+
+    string(TIMESTAMP START "${TIMESTAMP_FORMAT}")
+    execute_process(
+        COMMAND ${COMPILER} -std=c++20 -fsyntax-only ${TIME_FLAGS} -I${INCLUDE_DIR} ${SOURCE}
+        WORKING_DIRECTORY ${OUTPUT_DIR}
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE REPORT)
+    string(TIMESTAMP END "${TIMESTAMP_FORMAT}")
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Compiling ${SOURCE} failed:\n${REPORT}")
+    endif()
+    file(WRITE ${OUTPUT_DIR}/chain_${STAGE_COUNT}.time.txt "${REPORT}")
+
+    math(EXPR MILLISECONDS "(${END} - ${START}) ${TIMESTAMP_TO_MILLISECONDS}")
+    message(STATUS "${STAGE_COUNT} | ${MILLISECONDS} ms")
+    string(REGEX MATCH "template instantiation[^\n]*" INSTANTIATION "${REPORT}")
+    if(INSTANTIATION)
+        message(STATUS "    ${INSTANTIATION}")
+    endif()
+endforeach()
+message(STATUS "Time reports written to ${OUTPUT_DIR}")
@@ -0,0 +1,162 @@
+#include "testentities.hpp"
+#include <benchmark/benchmark.h>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace scopefn;
+
+namespace
+{
+Person makePerson()
+{
+    return Person{.name = "Alice", .location = "London", .age = 20};
+}
+
+std::vector<int> makeVector(size_t size)
+{
+    std::vector<int> vec(size);
+    std::iota(vec.begin(), vec.end(), 0);
+    return vec;
+}
+} // namespace
+
+// Small structs: modify a Person and read back a field
+
+static void BM_PersonRaw(benchmark::State& state)
+{
+    Person person = makePerson();
+    for(auto _ : state)
+    {
+        person.incrementAge();
+        person.location = "Paris";
+        unsigned age = person.age;
+        benchmark::DoNotOptimize(age);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PersonRaw);
+
+static void BM_PersonCrtp(benchmark::State& state)
+{
+    Person person = makePerson();
+    for(auto _ : state)
+    {
+        unsigned age = person.apply([self = &person] { self->incrementAge(); })
+                             .also([](Person& it) { it.location = "Paris"; })
+                             .let([](Person& it) { return it.age; });
+        benchmark::DoNotOptimize(age);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PersonCrtp);
+
+static void BM_PersonFreestanding(benchmark::State& state)
+{
+    Person person = makePerson();
+    for(auto _ : state)
+    {
+        unsigned age = person | also(&Person::incrementAge)
+                              | also([](Person& it) { it.location = "Paris"; })
+                              | let([](Person& it) { return it.age; });
+        benchmark::DoNotOptimize(age);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PersonFreestanding);
+
+static void BM_PersonPipeline(benchmark::State& state)
+{
+    Person person = makePerson();
+    auto stages = also(&Person::incrementAge)
+                | also([](Person& it) { it.location = "Paris"; })
+                | let([](Person& it) { return it.age; });
+    for(auto _ : state)
+    {
+        unsigned age = person | stages;
+        benchmark::DoNotOptimize(age);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_PersonPipeline);
+
+// Large vectors: reduce the whole container inside the scope function
+
+static void BM_VectorSumRaw(benchmark::State& state)
+{
+    std::vector<int> vec = makeVector(state.range(0));
+    for(auto _ : state)
+    {
+        long sum = std::accumulate(vec.begin(), vec.end(), 0L);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSumRaw)->Range(1 << 10, 1 << 20);
+
+static void BM_VectorSumFreestanding(benchmark::State& state)
+{
+    std::vector<int> vec = makeVector(state.range(0));
+    for(auto _ : state)
+    {
+        long sum = vec | let([](std::vector<int>& it)
+                             { return std::accumulate(it.begin(), it.end(), 0L); });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSumFreestanding)->Range(1 << 10, 1 << 20);
+
+// Large vectors: move a temporary through a chain of stages
+
+static void BM_VectorMoveRaw(benchmark::State& state)
+{
+    for(auto _ : state)
+    {
+        std::vector<int> vec = makeVector(state.range(0));
+        vec.push_back(1);
+        vec.back() *= 2;
+        benchmark::DoNotOptimize(vec.data());
+    }
+}
+BENCHMARK(BM_VectorMoveRaw)->Range(1 << 10, 1 << 20);
+
+static void BM_VectorMoveFreestanding(benchmark::State& state)
+{
+    for(auto _ : state)
+    {
+        std::vector<int> vec = makeVector(state.range(0))
+            | let([](std::vector<int>&& it) { it.push_back(1); return std::move(it); })
+            | also([](std::vector<int>& it) { it.back() *= 2; });
+        benchmark::DoNotOptimize(vec.data());
+    }
+}
+BENCHMARK(BM_VectorMoveFreestanding)->Range(1 << 10, 1 << 20);
+
+// Strings: build up a string through several stages
+
+static void BM_StringRaw(benchmark::State& state)
+{
+    for(auto _ : state)
+    {
+        std::string str(state.range(0), 'a');
+        str.append("hello");
+        str[0] = 'y';
+        size_t size = str.size();
+        benchmark::DoNotOptimize(size);
+    }
+}
+BENCHMARK(BM_StringRaw)->Range(8, 1 << 16);
+
+static void BM_StringFreestanding(benchmark::State& state)
+{
+    for(auto _ : state)
+    {
+        size_t size = std::string(state.range(0), 'a')
+            | also([](std::string& it) { it.append("hello"); })
+            | also([](std::string& it) { it[0] = 'y'; })
+            | let([](std::string& it) { return it.size(); });
+        benchmark::DoNotOptimize(size);
+    }
+}
+BENCHMARK(BM_StringFreestanding)->Range(8, 1 << 16);
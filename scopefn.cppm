@@ -0,0 +1,20 @@
+// Module interface unit for the scope functions. Importing the module instead
+// of including scopefn.hpp parses the header and its standard library includes
+// once per build instead of once per TU.
+//
+//     import scopefn;
+
+module;
+
+#include <optional>
+#include <source_location>
+#include <type_traits>
+#include <utility>
+#if __has_include(<expected>)
+#include <expected>
+#endif
+
+export module scopefn;
+
+#define SCOPEFN_EXPORT export
+#include "scopefn.hpp"
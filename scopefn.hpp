@@ -1,7 +1,22 @@
 #ifndef _SCOPEFN_H
 #define _SCOPEFN_H
 
-#include <functional>
+#include <optional>
+#include <source_location>
+#include <type_traits>
+#include <utility>
+#if __has_include(<expected>)
+#include <expected>
+#endif
+
+/**
+ * @brief Marks the public declarations of the library. Expands to nothing for
+ * regular includes and to `export` when included from the scopefn module
+ * interface unit.
+ */
+#ifndef SCOPEFN_EXPORT
+#define SCOPEFN_EXPORT
+#endif
 
 namespace scopefn {
 
@@ -17,8 +32,164 @@ template<typename T>
 using base_type = typename std::remove_cv<typename std::remove_reference<T>::type>::type;
 
 /**
- * @brief Helper struct used for template argument deduction on
- * std::function<R(A)>.
+ * @brief Helper struct exposing the class of a pointer to member.
+ *
+ * @tparam T - pointer to member type
+ */
+template<typename T>
+struct MemberPointerClass {};
+
+template<typename M, typename C>
+struct MemberPointerClass<M C::*>
+{
+    using type = C;
+};
+
+/**
+ * @brief Calls a pointer to member on an object, a pointer to an object or a
+ * reference wrapper, the same way std::invoke does.
+ *
+ * @tparam M - pointer to member type
+ * @tparam Object - type of object, pointer or reference wrapper
+ * @tparam Args - argument types of the member function
+ */
+template<typename M, typename Object, typename... Args>
+constexpr decltype(auto) invokeMember(M member, Object&& object, Args&&... args)
+{
+    using Class = typename MemberPointerClass<M>::type;
+    if constexpr (std::is_base_of_v<Class, base_type<Object>>)
+    {
+        if constexpr (std::is_member_function_pointer_v<M>)
+            return (std::forward<Object>(object).*member)(std::forward<Args>(args)...);
+        else
+            return std::forward<Object>(object).*member;
+    }
+    else if constexpr (requires { object.get(); })
+        return scopefn_internal::invokeMember(member, object.get(), std::forward<Args>(args)...);
+    else
+        return scopefn_internal::invokeMember(member, *std::forward<Object>(object),
+                                              std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Replacement for std::invoke, so that the scope functions don't need
+ * to include the heavy <functional> header in every TU.
+ *
+ * @tparam F - type of callable
+ * @tparam Args - argument types
+ */
+template<typename F, typename... Args>
+constexpr decltype(auto) invoke(F&& callable, Args&&... args)
+    noexcept(std::is_nothrow_invocable_v<F, Args...>)
+{
+    if constexpr (std::is_member_pointer_v<base_type<F>>)
+        return scopefn_internal::invokeMember(callable, std::forward<Args>(args)...);
+    else
+        return std::forward<F>(callable)(std::forward<Args>(args)...);
+}
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Function object calling the pointer to member Member on its
+ * argument. A pointer to member passed at runtime results in a direct call,
+ * but the call is not always inlined. With member the pointer is part of the
+ * type, so the call is inlined just like the hand-written member call.
+ *
+ * @example animal.apply(member<&Animal::doSomething>{});
+ *
+ * @tparam Member - pointer to member
+ */
+SCOPEFN_EXPORT template<auto Member>
+struct member
+{
+    static_assert(std::is_member_pointer_v<decltype(Member)>, "member requires a pointer to member");
+
+    template<typename Object>
+    constexpr decltype(auto) operator()(Object&& object) const
+        noexcept(std::is_nothrow_invocable_v<decltype(Member), Object>)
+    {
+        using Class = typename scopefn_internal::MemberPointerClass<decltype(Member)>::type;
+        // Applying the constant directly lets the compiler resolve the call
+        // before inlining, passing it on to invokeMember would not
+        if constexpr (!std::is_base_of_v<Class, scopefn_internal::base_type<Object>>)
+            return scopefn_internal::invokeMember(Member, std::forward<Object>(object));
+        else if constexpr (std::is_member_function_pointer_v<decltype(Member)>)
+            return (std::forward<Object>(object).*Member)();
+        else
+            return std::forward<Object>(object).*Member;
+    }
+};
+
+namespace scopefn_internal {
+
+template<typename T>
+struct IsMember : std::false_type {};
+
+template<auto Member>
+struct IsMember<member<Member>> : std::true_type {};
+
+/**
+ * @brief Satisfied by pointers to members and by member function objects,
+ * which `run` and `apply` invoke on the context object.
+ *
+ * @tparam L
+ */
+template<typename L>
+concept ReceiverCallable = std::is_member_pointer_v<L> || IsMember<L>::value;
+
+/**
+ * @brief Projection passing the context object on unchanged, the default
+ * projection of `let` and `also`.
+ */
+struct Identity
+{
+    template<typename T>
+    constexpr T&& operator()(T&& object) const noexcept { return std::forward<T>(object); }
+};
+
+/**
+ * @brief Helper alias for the type of applying projection P to a context
+ * object of type T.
+ *
+ * @tparam P - type of projection
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename P, typename T>
+using projected = decltype(scopefn_internal::invoke(std::declval<P&>(), std::declval<T>()));
+
+/**
+ * @brief Invokes the lambda of `run` or `apply`, which accepts no arguments.
+ * Pointers to members and member function objects are invoked on the context
+ * object instead, like the receiver of a Kotlin `run` or `apply` block.
+ *
+ * @tparam L - type of lambda
+ * @tparam Object - type of context object
+ */
+template<typename L, typename Object>
+constexpr decltype(auto) invokeReceiver(L& lambda, Object& contextObject)
+    noexcept(ReceiverCallable<L> ? std::is_nothrow_invocable_v<L&, Object&>
+                                 : std::is_nothrow_invocable_v<L&>)
+{
+    if constexpr (ReceiverCallable<L>)
+        return scopefn_internal::invoke(lambda, contextObject);
+    else
+        return scopefn_internal::invoke(lambda);
+}
+
+/**
+ * @brief Helper alias for the value returned by `run` with lambda L on a
+ * context object of type Object.
+ *
+ * @tparam L - type of lambda
+ * @tparam Object - type of context object
+ */
+template<typename L, typename Object>
+using receiver_result = base_type<decltype(invokeReceiver(std::declval<L&>(), std::declval<Object&>()))>;
+
+/**
+ * @brief Helper struct describing the signature of a callable with exactly one
+ * argument.
  *
  * @tparam RT - return type
  * @tparam AT - argument type
@@ -26,54 +197,359 @@ using base_type = typename std::remove_cv<typename std::remove_reference<T>::typ
 template<typename RT, typename AT>
 struct FuncType
 {
-    FuncType(std::function<RT(AT)>) {};
+    static constexpr bool deducible = true;
     using return_type = RT;
     using argument_type = AT;
 };
 
 /**
- * @brief Helper struct used for template argument deduction on
- * std::function<R(void)>. This struct exists because void cannot be deduced
- * from the regular FuncType struct
- *
- * @tparam RT - return type
+ * @brief Helper struct used for signatures that cannot be named, for example
+ * call operators that are templates, overloaded or take more than one
+ * argument.
  */
-template<typename RT>
-struct FuncTypeNoArg
+struct FuncTypeUnknown
 {
-    FuncTypeNoArg(std::function<RT(void)>) {};
-    using return_type = RT;
-    using argument_type = void;
+    static constexpr bool deducible = false;
 };
 
+/**
+ * @brief Signature of a call operator obtained via &T::operator(). Lambdas
+ * have either a const or (when mutable) a non-const call operator.
+ *
+ * @tparam T - pointer to member function type
+ */
+template<typename T>
+struct CallOperatorSignature : FuncTypeUnknown {};
+
+template<typename RT, typename C, typename AT>
+struct CallOperatorSignature<RT (C::*)(AT)> : FuncType<RT, AT> {};
+
+template<typename RT, typename C, typename AT>
+struct CallOperatorSignature<RT (C::*)(AT) const> : FuncType<RT, AT> {};
+
+template<typename RT, typename C, typename AT>
+struct CallOperatorSignature<RT (C::*)(AT) noexcept> : FuncType<RT, AT> {};
+
+template<typename RT, typename C, typename AT>
+struct CallOperatorSignature<RT (C::*)(AT) const noexcept> : FuncType<RT, AT> {};
+
+/**
+ * @brief Signature of a one argument callable. Function pointers and function
+ * objects with a single, non-template call operator have a deducible argument
+ * type. Generic lambdas, overloaded function objects and member pointers don't,
+ * and are only checked for invocability against the context object.
+ *
+ * @tparam T - type of callable
+ */
+template<typename T, typename = void>
+struct CallableSignature : FuncTypeUnknown {};
+
+template<typename RT, typename AT>
+struct CallableSignature<RT (*)(AT)> : FuncType<RT, AT> {};
+
+template<typename RT, typename AT>
+struct CallableSignature<RT (*)(AT) noexcept> : FuncType<RT, AT> {};
+
+template<typename T>
+struct CallableSignature<T, std::void_t<decltype(&T::operator())>>
+    : CallOperatorSignature<decltype(&T::operator())> {};
+
+/**
+ * @brief Helper alias selecting how the context object is passed to a lambda.
+ * Rvalue context objects are passed as rvalues when the lambda accepts them,
+ * so they can be moved through a chain, and as lvalues otherwise.
+ *
+ * @tparam L - type of lambda
+ * @tparam Context - type of context object, a reference type for lvalues
+ */
+template<typename L, typename Context>
+using context_argument =
+    std::conditional_t<std::is_invocable_v<L&, Context&&>, Context&&, Context&>;
+
 /**
  * @brief Type to enable lambda function reflection.
- * An instantiated LambdaReflection<LambdaType> provides aliases for the return 
- * type and argument type of a lambda. This feature is implemented using 
- * std::function and suffers from the same limitations as std::function 
- * reflection. This template struct supports only lambdas with one argument.
+ * An instantiated LambdaReflection<LambdaType, ContextType> provides an alias
+ * for the type returned when the lambda is invoked with the context object.
+ * The type is computed with std::invoke_result, so generic lambdas, function
+ * pointers, member function pointers and function objects are supported.
  * 
  * @tparam T - type of lambda
+ * @tparam Context - type of context object
  */
-template<typename T>
+template<typename T, typename Context>
 struct LambdaReflection
 {
-    using return_type = base_type<typename decltype(FuncType(std::function(std::declval<T>())))::return_type>;
-    using argument_type = base_type<typename decltype(FuncType(std::function(std::declval<T>())))::argument_type>;
+    using return_type = base_type<std::invoke_result_t<T&, context_argument<T, Context>>>;
 };
 
 /**
- * @brief Same as LambdaReflection, but for lambdas that accept no args, since
- * void arg type cannot be deduced by std::function.
+ * @brief Same as LambdaReflection, but for lambdas that accept no args.
  *
  * @tparam T
  */
 template<typename T>
 struct LambdaReflectionNoArg
 {
-    using return_type = base_type<typename decltype(FuncTypeNoArg(std::function(std::declval<T>())))::return_type>;
+    using return_type = base_type<std::invoke_result_t<T&>>;
+};
+
+/**
+ * @brief Satisfied when lambda L can be invoked with the context object. If
+ * the argument type of L can be deduced it must also match the context object
+ * type, so that no converted temporary is silently passed to the lambda.
+ *
+ * @tparam L - type of lambda
+ * @tparam Context - type of context object, a reference type for lvalues
+ */
+template<typename L, typename Context>
+concept ContextCallable =
+    std::is_invocable_v<L&, context_argument<L, Context>> &&
+    (!CallableSignature<base_type<L>>::deducible ||
+     std::is_same_v<base_type<typename CallableSignature<base_type<L>>::argument_type>,
+                    base_type<Context>>);
+
+/**
+ * @brief Checks that invoking lambda L with Args and returning the result by
+ * value, as `let` and `run` do, cannot throw. Used for the noexcept
+ * specification of the scope functions.
+ *
+ * @tparam L - type of lambda
+ * @tparam Args - argument types
+ */
+template<typename L, typename... Args>
+constexpr bool nothrowInvocable()
+{
+    if constexpr (std::is_invocable_v<L&, Args...>)
+    {
+        using Result = std::invoke_result_t<L&, Args...>;
+        return std::is_nothrow_invocable_v<L&, Args...> &&
+               (!std::is_reference_v<Result> ||
+                std::is_nothrow_constructible_v<base_type<Result>, Result>);
+    }
+    else
+    {
+        return false;
+    }
+}
+
+/**
+ * @brief Same as nothrowInvocable, for the lambdas of `run` and `apply` which
+ * are invoked with invokeReceiver.
+ *
+ * @tparam L - type of lambda
+ * @tparam Object - type of context object
+ */
+template<typename L, typename Object>
+constexpr bool nothrowReceiver()
+{
+    if constexpr (ReceiverCallable<L>)
+        return nothrowInvocable<L, Object&>();
+    else
+        return nothrowInvocable<L>();
+}
+
+/**
+ * @brief Gives every lambda type a unique address, used to tell the stages of
+ * a chain apart when tracing.
+ *
+ * @tparam L
+ */
+template<typename L>
+struct StageTag
+{
+    static constexpr char id = 0;
+};
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Describes a traced scope function call to the tracer. The id is
+ * unique for every lambda type, so it identifies a stage of a chain, and the
+ * location is the call site of the scope function.
+ */
+SCOPEFN_EXPORT struct stage_info
+{
+    const char* function;
+    const void* id;
+    std::source_location location;
+};
+
+/**
+ * @brief Tracer policy disabling tracing, all tracing code compiles to
+ * nothing. Tracing is also disabled for every tracer when SCOPEFN_NO_TRACING
+ * is defined.
+ *
+ * A tracer has a `begin(stage_info)` member function called before the
+ * lambda, whose result is passed to its `end(stage_info, token)` member
+ * function called after the lambda returns or throws.
+ */
+SCOPEFN_EXPORT struct NoTracer {};
+
+namespace scopefn_internal {
+
+/**
+ * @brief Satisfied by tracers which are called, so not by NoTracer or when
+ * tracing is disabled with SCOPEFN_NO_TRACING.
+ *
+ * @tparam T - tracer, a reference type for tracers held by reference
+ */
+template<typename T>
+concept TracingEnabled =
+#ifdef SCOPEFN_NO_TRACING
+    false &&
+#endif
+    !std::is_same_v<base_type<T>, NoTracer>;
+
+/**
+ * @brief Calls the tracer around a scope function call for as long as it is
+ * alive. The tracer is default constructed when none is given, as done for
+ * the tracer policy of ScopeFunctions.
+ *
+ * @tparam T - tracer, a reference type for tracers held by reference
+ */
+template<typename T>
+struct TraceScope
+{
+    using token_type = decltype(std::declval<T&>().begin(std::declval<stage_info>()));
+
+    explicit TraceScope(stage_info stage) : info(stage), token(tracer.begin(info)) {}
+    TraceScope(T& stageTracer, stage_info stage)
+        : tracer(stageTracer), info(stage), token(tracer.begin(info)) {}
+    TraceScope(const TraceScope&) = delete;
+    ~TraceScope() { tracer.end(info, std::move(token)); }
+
+    T tracer;
+    stage_info info;
+    token_type token;
+};
+
+template<typename T>
+    requires (!TracingEnabled<T>)
+struct TraceScope<T>
+{
+    constexpr explicit TraceScope(stage_info) noexcept {}
+    constexpr TraceScope(const base_type<T>&, stage_info) noexcept {}
+};
+
+/**
+ * @brief True when calling tracer T cannot throw, or T doesn't trace.
+ *
+ * @tparam T - tracer, a reference type for tracers held by reference
+ */
+template<typename T>
+constexpr bool nothrowTracer()
+{
+    if constexpr (TracingEnabled<T>)
+        return noexcept(std::declval<T&>().end(std::declval<stage_info>(),
+                                               std::declval<typename TraceScope<T>::token_type>())) &&
+               noexcept(std::declval<T&>().begin(std::declval<stage_info>())) &&
+               (std::is_reference_v<T> || std::is_nothrow_default_constructible_v<T>);
+    else
+        return true;
+}
+
+/**
+ * @brief Helper returning the stage_info of a call to the scope function
+ * named function with lambda type L.
+ *
+ * @tparam L
+ */
+template<typename L>
+constexpr stage_info stageInfo(const char* function, std::source_location location) noexcept
+{
+    return {function, &StageTag<L>::id, location};
+}
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Optional reference to a context object, returned by `take_if` and
+ * `take_unless`. It refers to the context object instead of copying it, so
+ * for temporary context objects it must be used within the same expression,
+ * just like the result of `also`. Scope functions chained after it with
+ * operator| are skipped when it is empty.
+ *
+ * @example person | take_if([](Person& it){ return it.age > 18; })
+ *                 | also([](Person& it){ it.vote(); });
+ *
+ * @tparam T - referenced type, possibly const qualified
+ */
+SCOPEFN_EXPORT template<typename T>
+struct optional_ref
+{
+    constexpr optional_ref() noexcept = default;
+    constexpr explicit optional_ref(T& value) noexcept : pointer(&value) {}
+
+    constexpr bool has_value() const noexcept { return pointer != nullptr; }
+    constexpr explicit operator bool() const noexcept { return has_value(); }
+    constexpr T& operator*() const noexcept { return *pointer; }
+    constexpr T* operator->() const noexcept { return pointer; }
+    constexpr T& value_or(T& fallback) const noexcept { return pointer ? *pointer : fallback; }
+
+private:
+    T* pointer = nullptr;
+};
+
+namespace scopefn_internal {
+
+/**
+ * @brief Returns an optional reference to contextObject when the predicate
+ * returns condition for it, and an empty one otherwise.
+ *
+ * @tparam P - type of predicate
+ * @tparam T - type of context object
+ */
+template<typename P, typename T>
+constexpr optional_ref<T> takeWhen(bool condition, P& predicate, T& contextObject)
+    noexcept(std::is_nothrow_invocable_v<P&, T&>)
+{
+    if(static_cast<bool>(scopefn_internal::invoke(predicate, contextObject)) == condition)
+        return optional_ref<T>(contextObject);
+    return {};
+}
+
+/**
+ * @brief Moves the first argument to the back Rotations times and then
+ * invokes the first argument with the others. Used by `with` to invoke its
+ * last argument, the lambda, with the context objects in front of it, without
+ * packing them into a tuple.
+ *
+ * @tparam Rotations - number of arguments in front of the callable
+ */
+template<std::size_t Rotations>
+struct InvokeRotated
+{
+    template<typename First, typename... Rest>
+    static constexpr decltype(auto) call(First&& first, Rest&&... rest)
+        noexcept(noexcept(InvokeRotated<Rotations - 1>::call(std::forward<Rest>(rest)..., std::forward<First>(first))))
+    {
+        return InvokeRotated<Rotations - 1>::call(std::forward<Rest>(rest)..., std::forward<First>(first));
+    }
+};
+
+template<>
+struct InvokeRotated<0>
+{
+    template<typename F, typename... Args>
+    static constexpr decltype(auto) call(F&& callable, Args&&... args)
+        noexcept(std::is_nothrow_invocable_v<F, Args...>)
+    {
+        return scopefn_internal::invoke(std::forward<F>(callable), std::forward<Args>(args)...);
+    }
 };
 
+/**
+ * @brief Checks that returning a value of type Result by value cannot throw.
+ *
+ * @tparam Result
+ */
+template<typename Result>
+constexpr bool nothrowReturn()
+{
+    return std::is_void_v<Result> || !std::is_reference_v<Result> ||
+           std::is_nothrow_constructible_v<base_type<Result>, Result>;
+}
+
 } // namespace scopefn_internal
 
 /**
@@ -82,10 +558,17 @@ struct LambdaReflectionNoArg
  * it doesn't change the size and memory layout of the derived class objects.
  * Calling the scope methods is done via static polymorphism via the CRTP
  * pattern. There are no virtual (indirect) function calls and no vtables.
+ * All scope functions are constexpr and can be used in constant expressions.
+ * A tracer policy can be given to record every scope method call, for
+ * example to time the stages of a chain. It is default constructed for each
+ * call, so it should be a lightweight handle to the recorded data.
+ *
+ * @example struct Animal : ScopeFunctions<Animal, LatencyHistogram> { ... };
  *
  * @tparam Base
+ * @tparam Tracer - tracer policy, tracing is disabled with NoTracer
  */
-template<typename Base>
+SCOPEFN_EXPORT template<typename Base, typename Tracer = NoTracer>
 struct ScopeFunctions
 {
     /**
@@ -96,51 +579,174 @@ struct ScopeFunctions
      *
      * @tparam L
      * @param lambda
-     * @return scopefn_internal::LambdaReflection<L>::return_type
+     * @param location - call site, reported to the tracer
+     * @return scopefn_internal::LambdaReflection<L, Base>::return_type
+     */
+    template<typename L>
+    constexpr auto let(L lambda, std::source_location location = std::source_location::current()) &
+        noexcept(scopefn_internal::nothrowInvocable<L, Base&>() &&
+                 scopefn_internal::nothrowTracer<Tracer>())
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<L, Base&>,
+            "Scope function `let` argument type must match context object type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("let", location));
+        return scopefn_internal::invoke(lambda, *static_cast<Base *>(this));
+    }
+
+    /**
+     * @brief Overload of `let` for temporary context objects. The context
+     * object is passed as an rvalue if the lambda accepts one, so it can be
+     * moved into the result instead of copied.
+     *
+     * @example Animal().let([](Animal&& it) { return std::move(it); });
+     *
+     * @tparam L
+     * @param lambda
+     * @param location - call site, reported to the tracer
+     * @return scopefn_internal::LambdaReflection<L, Base>::return_type
+     */
+    template<typename L>
+    constexpr auto let(L lambda, std::source_location location = std::source_location::current()) &&
+        noexcept(scopefn_internal::nothrowInvocable<L, scopefn_internal::context_argument<L, Base>>() &&
+                 scopefn_internal::nothrowTracer<Tracer>())
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<L, Base>,
+            "Scope function `let` argument type must match context object type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("let", location));
+        return scopefn_internal::invoke(
+            lambda,
+            static_cast<scopefn_internal::context_argument<L, Base>>(*static_cast<Base *>(this)));
+    }
+
+    /**
+     * @brief Overload of `let` for const context objects. The lambda receives
+     * the context object as a const reference, so read-only chains on shared
+     * objects need no copy.
+     *
+     * @example person.let([](const Person& it) { return it.age; });
+     *
+     * @tparam L
+     * @param lambda
+     * @param location - call site, reported to the tracer
+     * @return scopefn_internal::LambdaReflection<L, const Base&>::return_type
      */
     template<typename L>
-    auto let(L lambda) -> typename scopefn_internal::LambdaReflection<L>::return_type
+    constexpr auto let(L lambda, std::source_location location = std::source_location::current()) const&
+        noexcept(scopefn_internal::nothrowInvocable<L, const Base&>() &&
+                 scopefn_internal::nothrowTracer<Tracer>())
     {
         static_assert(
-            std::is_same_v<typename scopefn_internal::LambdaReflection<L>::argument_type, Base>,
+            scopefn_internal::ContextCallable<L, const Base&>,
             "Scope function `let` argument type must match context object type");
-        return lambda(*static_cast<Base *>(this));
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("let", location));
+        return scopefn_internal::invoke(lambda, *static_cast<const Base *>(this));
     }
 
     /**
      * @brief The `run` scope function accepts the context object through lambda
-     * capture and returns the lambda result.
+     * capture and returns the lambda result. A pointer to member is invoked on
+     * the context object instead.
      *
      * @example animal.run([self = &animal] { self->doSomething(); });
+     * @example animal.run(&Animal::name);
+     *
+     * @tparam L
+     * @param lambda
+     * @param location - call site, reported to the tracer
+     * @return scopefn_internal::receiver_result<L, Base>
+     */
+    template<typename L>
+    constexpr auto run(L lambda, std::source_location location = std::source_location::current())
+        noexcept(scopefn_internal::nothrowReceiver<L, Base>() &&
+                 scopefn_internal::nothrowTracer<Tracer>())
+        -> scopefn_internal::receiver_result<L, Base>
+    {
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("run", location));
+        return scopefn_internal::invokeReceiver(lambda, *static_cast<Base *>(this));
+    }
+
+    /**
+     * @brief Overload of `run` for const context objects.
      *
      * @tparam L
      * @param lambda
-     * @return scopefn_internal::LambdaReflectionNoArg<L>::return_type
+     * @param location - call site, reported to the tracer
+     * @return scopefn_internal::receiver_result<L, const Base>
      */
     template<typename L>
-    auto run(L lambda) -> typename scopefn_internal::LambdaReflectionNoArg<L>::return_type
+    constexpr auto run(L lambda, std::source_location location = std::source_location::current()) const
+        noexcept(scopefn_internal::nothrowReceiver<L, const Base>() &&
+                 scopefn_internal::nothrowTracer<Tracer>())
+        -> scopefn_internal::receiver_result<L, const Base>
     {
-        return lambda();
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("run", location));
+        return scopefn_internal::invokeReceiver(lambda, *static_cast<const Base *>(this));
     }
 
     /**
      * @brief The `apply` scope function accepts the context object through
-     * lambda capture and returns a reference to the same context object.
+     * lambda capture and returns a reference to the same context object. A
+     * pointer to member function is invoked on the context object instead.
      *
      * @example animal.apply([self = &animal] { self->doSomething(); });
+     * @example animal.apply(&Animal::doSomething);
      *
      * @tparam L
      * @param lambda
+     * @param location - call site, reported to the tracer
      * @return Base&
      */
     template<typename L>
-    auto apply(L lambda) -> Base&
+    constexpr auto apply(L lambda, std::source_location location = std::source_location::current()) &
+        noexcept(scopefn_internal::nothrowReceiver<L, Base>() &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> Base&
     {
         
-        lambda();
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("apply", location));
+        scopefn_internal::invokeReceiver(lambda, *static_cast<Base *>(this));
         return *static_cast<Base *>(this);
     }
 
+    /**
+     * @brief Overload of `apply` for temporary context objects, which returns
+     * an rvalue reference so the context object can be moved further along.
+     *
+     * @tparam L
+     * @param lambda
+     * @param location - call site, reported to the tracer
+     * @return Base&&
+     */
+    template<typename L>
+    constexpr auto apply(L lambda, std::source_location location = std::source_location::current()) &&
+        noexcept(scopefn_internal::nothrowReceiver<L, Base>() &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> Base&&
+    {
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("apply", location));
+        scopefn_internal::invokeReceiver(lambda, *static_cast<Base *>(this));
+        return std::move(*static_cast<Base *>(this));
+    }
+
+    /**
+     * @brief Overload of `apply` for const context objects, which returns a
+     * const reference to the context object.
+     *
+     * @tparam L
+     * @param lambda
+     * @param location - call site, reported to the tracer
+     * @return const Base&
+     */
+    template<typename L>
+    constexpr auto apply(L lambda, std::source_location location = std::source_location::current()) const&
+        noexcept(scopefn_internal::nothrowReceiver<L, const Base>() &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> const Base&
+    {
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("apply", location));
+        scopefn_internal::invokeReceiver(lambda, *static_cast<const Base *>(this));
+        return *static_cast<const Base *>(this);
+    }
+
     /**
      * @brief The `also` scope function accepts the context object as an
      * argument and returns a reference to the same context object.
@@ -149,209 +755,977 @@ struct ScopeFunctions
      *
      * @tparam L
      * @param lambda
+     * @param location - call site, reported to the tracer
      * @return Base&
      */
     template<typename L>
-    auto also(L lambda) -> Base&
+    constexpr auto also(L lambda, std::source_location location = std::source_location::current()) &
+        noexcept(std::is_nothrow_invocable_v<L&, Base&> &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> Base&
     {
         static_assert(
-            std::is_same_v<Base, typename scopefn_internal::LambdaReflection<L>::argument_type>,
+            scopefn_internal::ContextCallable<L, Base&>,
             "Scope function `also` argument type must match context object "
             "type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("also", location));
 
-        lambda(*static_cast<Base*>(this));
+        scopefn_internal::invoke(lambda, *static_cast<Base*>(this));
         return *static_cast<Base*>(this);
     }
-};
+
+    /**
+     * @brief Overload of `also` for temporary context objects. The lambda
+     * receives the context object as an lvalue, and an rvalue reference is
+     * returned so the context object can be moved further along.
+     *
+     * @tparam L
+     * @param lambda
+     * @param location - call site, reported to the tracer
+     * @return Base&&
+     */
+    template<typename L>
+    constexpr auto also(L lambda, std::source_location location = std::source_location::current()) &&
+        noexcept(std::is_nothrow_invocable_v<L&, Base&> &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> Base&&
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<L, Base&>,
+            "Scope function `also` argument type must match context object "
+            "type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("also", location));
+
+        scopefn_internal::invoke(lambda, *static_cast<Base*>(this));
+        return std::move(*static_cast<Base*>(this));
+    }
+
+    /**
+     * @brief Overload of `also` for const context objects. The lambda
+     * receives the context object as a const reference and a const reference
+     * to the context object is returned.
+     *
+     * @example person.also([](const Person& it) { log(it.name); });
+     *
+     * @tparam L
+     * @param lambda
+     * @param location - call site, reported to the tracer
+     * @return const Base&
+     */
+    template<typename L>
+    constexpr auto also(L lambda, std::source_location location = std::source_location::current()) const&
+        noexcept(std::is_nothrow_invocable_v<L&, const Base&> &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> const Base&
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<L, const Base&>,
+            "Scope function `also` argument type must match context object "
+            "type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<L>("also", location));
+
+        scopefn_internal::invoke(lambda, *static_cast<const Base*>(this));
+        return *static_cast<const Base*>(this);
+    }
+
+    /**
+     * @brief The `take_if` scope function accepts the context object as an
+     * argument of the predicate and returns an optional reference to the same
+     * context object if the predicate is satisfied, or an empty one otherwise.
+     *
+     * @example animal.take_if([](Animal& it) { return it.isHungry(); });
+     *
+     * @tparam P
+     * @param predicate
+     * @param location - call site, reported to the tracer
+     * @return optional_ref<Base>
+     */
+    template<typename P>
+    constexpr auto take_if(P predicate, std::source_location location = std::source_location::current())
+        noexcept(std::is_nothrow_invocable_v<P&, Base&> &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> optional_ref<Base>
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<P, Base&>,
+            "Scope function `take_if` argument type must match context object "
+            "type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<P>("take_if", location));
+        return scopefn_internal::takeWhen(true, predicate, *static_cast<Base*>(this));
+    }
+
+    /**
+     * @brief Overload of `take_if` for const context objects, which returns an
+     * optional const reference.
+     *
+     * @tparam P
+     * @param predicate
+     * @param location - call site, reported to the tracer
+     * @return optional_ref<const Base>
+     */
+    template<typename P>
+    constexpr auto take_if(P predicate, std::source_location location = std::source_location::current()) const
+        noexcept(std::is_nothrow_invocable_v<P&, const Base&> &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> optional_ref<const Base>
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<P, const Base&>,
+            "Scope function `take_if` argument type must match context object "
+            "type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<P>("take_if", location));
+        return scopefn_internal::takeWhen(true, predicate, *static_cast<const Base*>(this));
+    }
+
+    /**
+     * @brief The `take_unless` scope function accepts the context object as
+     * an argument of the predicate and returns an optional reference to the
+     * same context object if the predicate is not satisfied, or an empty one
+     * otherwise.
+     *
+     * @example animal.take_unless([](Animal& it) { return it.isAsleep(); });
+     *
+     * @tparam P
+     * @param predicate
+     * @param location - call site, reported to the tracer
+     * @return optional_ref<Base>
+     */
+    template<typename P>
+    constexpr auto take_unless(P predicate, std::source_location location = std::source_location::current())
+        noexcept(std::is_nothrow_invocable_v<P&, Base&> &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> optional_ref<Base>
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<P, Base&>,
+            "Scope function `take_unless` argument type must match context object "
+            "type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<P>("take_unless", location));
+        return scopefn_internal::takeWhen(false, predicate, *static_cast<Base*>(this));
+    }
+
+    /**
+     * @brief Overload of `take_unless` for const context objects, which
+     * returns an optional const reference.
+     *
+     * @tparam P
+     * @param predicate
+     * @param location - call site, reported to the tracer
+     * @return optional_ref<const Base>
+     */
+    template<typename P>
+    constexpr auto take_unless(P predicate, std::source_location location = std::source_location::current()) const
+        noexcept(std::is_nothrow_invocable_v<P&, const Base&> &&
+                 scopefn_internal::nothrowTracer<Tracer>()) -> optional_ref<const Base>
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<P, const Base&>,
+            "Scope function `take_unless` argument type must match context object "
+            "type");
+        scopefn_internal::TraceScope<Tracer> trace(scopefn_internal::stageInfo<P>("take_unless", location));
+        return scopefn_internal::takeWhen(false, predicate, *static_cast<const Base*>(this));
+    }
+};
 
 /**
  * @brief Freestanding let scope function. The `let` scope function accepts the
- * context object via argument and returns the lambda result.
+ * context object via argument and returns the lambda result. The lambda is
+ * stored by its own type, so calling it is a direct call just like the CRTP
+ * `ScopeFunctions<Base>::let` method. An optional projection, like a pointer
+ * to member, is applied to the context object before it is passed to the
+ * lambda.
  *
  * @example animal | let([](Animal& it){ it.doSomething(); });
+ * @example animal | let(&Animal::name, [](std::string& it){ return it.size(); });
  *
- * @tparam T
+ * @tparam L
+ * @tparam Projection
  */
-template <typename L>
+SCOPEFN_EXPORT template <typename L, typename Projection = scopefn_internal::Identity>
 struct let
 {
-    using ARG = typename scopefn_internal::LambdaReflection<L>::argument_type;
-    using RT = typename scopefn_internal::LambdaReflection<L>::return_type;
-    let(L lambda) : fun(lambda) {}
-    RT operator()(ARG& contextObject) { return fun(contextObject); }
+    constexpr let(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+    constexpr let(Projection projectionFunction, L lambda)
+        noexcept(std::is_nothrow_move_constructible_v<L> && std::is_nothrow_move_constructible_v<Projection>)
+        : projection(std::move(projectionFunction)), fun(std::move(lambda)) {}
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject)
+        noexcept(std::is_nothrow_invocable_v<Projection&, T> &&
+                 scopefn_internal::nothrowInvocable<L, scopefn_internal::context_argument<L, projected<T>>>())
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<L, projected<T>>,
+            "Scope function `let` argument type must match context object type");
+        auto&& projectedObject = scopefn_internal::invoke(projection, std::forward<T>(contextObject));
+        return scopefn_internal::invoke(
+            fun, static_cast<scopefn_internal::context_argument<L, projected<T>>>(projectedObject));
+    }
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) const
+        noexcept(std::is_nothrow_invocable_v<const Projection&, T> &&
+                 scopefn_internal::nothrowInvocable<const L, scopefn_internal::context_argument<const L, projected<T>>>())
+    {
+        static_assert(
+            scopefn_internal::ContextCallable<const L, projected<T>>,
+            "Scope function `let` argument type must match context object type");
+        auto&& projectedObject = scopefn_internal::invoke(projection, std::forward<T>(contextObject));
+        return scopefn_internal::invoke(
+            fun, static_cast<scopefn_internal::context_argument<const L, projected<T>>>(projectedObject));
+    }
+
+    template<typename T>
+    using projected = scopefn_internal::projected<Projection, T>;
 
-    std::function<RT(ARG &)> fun;
+    [[no_unique_address]] Projection projection;
+    L fun;
 };
 
 /**
- * @brief Chaining operator for the frestanding let function
- * 
- * @tparam T 
- * @tparam L 
- * @param contextObject 
- * @param lambda 
- * @return let<L>::RT 
+ * @brief Freestanding run scope function. The `run` scope function accepts the
+ * context object through lambda capture and returns the lambda result.
+ *
+ * @example animal | run([self = &animal]{ self->doSomething(); });
+ *
+ * @tparam L
  */
-template<typename T, typename L>
-auto operator|(T& contextObject, let<L>&& lambda) -> typename let<L>::RT
+SCOPEFN_EXPORT template <typename L>
+struct run
 {
-    static_assert(
-        std::is_same_v<T, typename let<L>::ARG>,
-        "Scope function `let` argument type must match context object type");
-    return lambda(contextObject);
-}
+    using RT = typename scopefn_internal::LambdaReflectionNoArg<L>::return_type;
+    constexpr run(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+    constexpr RT operator()() noexcept(scopefn_internal::nothrowInvocable<L>())
+    {
+        return scopefn_internal::invoke(fun);
+    }
+
+    template<typename T>
+    constexpr RT operator()(T&&) noexcept(scopefn_internal::nothrowInvocable<L>())
+    {
+        return scopefn_internal::invoke(fun);
+    }
+
+    template<typename T>
+    constexpr RT operator()(T&&) const noexcept(scopefn_internal::nothrowInvocable<const L>())
+    {
+        return scopefn_internal::invoke(fun);
+    }
+
+    L fun;
+};
 
 /**
- * @brief Chaining operator for the freestanding let function
- * 
- * @tparam T 
- * @tparam L 
- * @param contextObject 
- * @param lambda 
- * @return let<L>::RT 
+ * @brief Freestanding with scope function. The `with` scope function invokes
+ * the lambda, given as the last argument, with the preceding context objects
+ * and returns the lambda result. Without context objects the lambda accepts
+ * the context object through lambda capture. Several context objects can be
+ * passed to work on them in a single block. The with scope function only
+ * exists as freestanding and cannot be chained.
+ *
+ * @example auto name = with([self = &animal]{ return self->name; });
+ * @example with(animal, owner, [](Animal& a, Person& p){ a.setOwner(p); });
+ *
+ * @tparam Args - types of context objects followed by the lambda type
+ * @return the lambda result
  */
-template<typename T, typename L>
-auto operator|(T&& contextObject, let<L>&& lambda) -> typename let<L>::RT
+SCOPEFN_EXPORT template <typename... Args>
+    requires (sizeof...(Args) > 0)
+constexpr auto with(Args&&... args)
+    noexcept(noexcept(scopefn_internal::InvokeRotated<sizeof...(Args) - 1>::call(std::forward<Args>(args)...)) &&
+             scopefn_internal::nothrowReturn<decltype(scopefn_internal::InvokeRotated<sizeof...(Args) - 1>::call(
+                 std::forward<Args>(args)...))>())
+    -> scopefn_internal::base_type<decltype(scopefn_internal::InvokeRotated<sizeof...(Args) - 1>::call(
+        std::forward<Args>(args)...))>
 {
-    static_assert(
-        std::is_same_v<T, typename let<L>::ARG>,
-        "Scope function `let` argument type must match context object type");
-    return lambda(contextObject);
+    return scopefn_internal::InvokeRotated<sizeof...(Args) - 1>::call(std::forward<Args>(args)...);
 }
 
 /**
- * @brief Freestanding run scope function. The `run` scope function accepts the
- * context object through lambda capture and returns the lambda result.
+ * @brief Freestanding also function. The `also` scope function accepts the
+ * context object as an argument and returns a reference to the same context
+ * object. An optional projection, like a pointer to member, is applied to the
+ * context object before it is passed to the lambda, the context object itself
+ * is still returned.
  *
- * @example animal | run([self = &animal]{ self->doSomething(); });
+ * @example animal | also([](Animal& it){ it.doSomething(); });
+ * @example animal | also(&Animal::name, [](std::string& it){ it += " the Great"; });
  *
  * @tparam L
+ * @tparam Projection
  */
-template <typename L>
-struct run
+SCOPEFN_EXPORT template <typename L, typename Projection = scopefn_internal::Identity>
+struct also
 {
-    using RT = typename scopefn_internal::LambdaReflectionNoArg<L>::return_type;
-    run(L lambda) : fun(lambda) {}
-    RT operator()() 
+    constexpr also(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+    constexpr also(Projection projectionFunction, L lambda)
+        noexcept(std::is_nothrow_move_constructible_v<L> && std::is_nothrow_move_constructible_v<Projection>)
+        : projection(std::move(projectionFunction)), fun(std::move(lambda)) {}
+
+    template<typename T>
+    constexpr T&& operator()(T&& contextObject)
+        noexcept(std::is_nothrow_invocable_v<Projection&, T&> &&
+                 std::is_nothrow_invocable_v<L&, projected<T&>&>)
+    {
+        static_assert(scopefn_internal::ContextCallable<L, projected<T&>&>,
+                      "Scope function `also` argument type must match return type "
+                      "which is the context object type");
+        auto&& projectedObject = scopefn_internal::invoke(projection, contextObject);
+        scopefn_internal::invoke(fun, projectedObject);
+        return std::forward<T>(contextObject);
+    }
+
+    template<typename T>
+    constexpr T&& operator()(T&& contextObject) const
+        noexcept(std::is_nothrow_invocable_v<const Projection&, T&> &&
+                 std::is_nothrow_invocable_v<const L&, projected<T&>&>)
     {
-        return fun();
+        static_assert(scopefn_internal::ContextCallable<const L, projected<T&>&>,
+                      "Scope function `also` argument type must match return type "
+                      "which is the context object type");
+        auto&& projectedObject = scopefn_internal::invoke(projection, contextObject);
+        scopefn_internal::invoke(fun, projectedObject);
+        return std::forward<T>(contextObject);
     }
 
-    std::function<RT(void)> fun;
+    template<typename T>
+    using projected = scopefn_internal::projected<Projection, T>;
+
+    [[no_unique_address]] Projection projection;
+    L fun;
 };
 
 /**
- * @brief Chaining operator for the run scope function
- * 
- * @tparam T 
- * @tparam L 
- * @param contextObject 
- * @param lambda 
- * @return run<L>::RT 
+ * @brief Freestanding take_if function. The `take_if` scope function accepts
+ * the context object as an argument of the predicate and returns an optional
+ * reference to the same context object if the predicate is satisfied, or an
+ * empty one otherwise.
+ *
+ * @example animal | take_if([](Animal& it){ return it.isHungry(); })
+ *                 | also([](Animal& it){ it.feed(); });
+ *
+ * @tparam P
  */
-template<typename T, typename L>
-auto operator|(T& contextObject, run<L>&& lambda) -> typename run<L>::RT
+SCOPEFN_EXPORT template <typename P>
+struct take_if
 {
-    return lambda();
-}
+    constexpr take_if(P predicate) noexcept(std::is_nothrow_move_constructible_v<P>)
+        : fun(std::move(predicate)) {}
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) noexcept(std::is_nothrow_invocable_v<P&, T&>)
+        -> optional_ref<std::remove_reference_t<T>>
+    {
+        static_assert(scopefn_internal::ContextCallable<P, T&>,
+                      "Scope function `take_if` argument type must match context object type");
+        return scopefn_internal::takeWhen(true, fun, contextObject);
+    }
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) const noexcept(std::is_nothrow_invocable_v<const P&, T&>)
+        -> optional_ref<std::remove_reference_t<T>>
+    {
+        static_assert(scopefn_internal::ContextCallable<const P, T&>,
+                      "Scope function `take_if` argument type must match context object type");
+        return scopefn_internal::takeWhen(true, fun, contextObject);
+    }
+
+    P fun;
+};
 
 /**
- * @brief Chaining operator for the run scope function
- * 
- * @tparam T 
- * @tparam L 
- * @param contextObject 
- * @param lambda 
- * @return run<L>::RT 
+ * @brief Freestanding take_unless function. The `take_unless` scope function
+ * accepts the context object as an argument of the predicate and returns an
+ * optional reference to the same context object if the predicate is not
+ * satisfied, or an empty one otherwise.
+ *
+ * @example animal | take_unless([](Animal& it){ return it.isAsleep(); })
+ *                 | also([](Animal& it){ it.play(); });
+ *
+ * @tparam P
  */
-template<typename T, typename L>
-auto operator|(T&& contextObject, run<L>&& lambda) -> typename run<L>::RT
+SCOPEFN_EXPORT template <typename P>
+struct take_unless
 {
-    return lambda();
-}
+    constexpr take_unless(P predicate) noexcept(std::is_nothrow_move_constructible_v<P>)
+        : fun(std::move(predicate)) {}
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) noexcept(std::is_nothrow_invocable_v<P&, T&>)
+        -> optional_ref<std::remove_reference_t<T>>
+    {
+        static_assert(scopefn_internal::ContextCallable<P, T&>,
+                      "Scope function `take_unless` argument type must match context object type");
+        return scopefn_internal::takeWhen(false, fun, contextObject);
+    }
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) const noexcept(std::is_nothrow_invocable_v<const P&, T&>)
+        -> optional_ref<std::remove_reference_t<T>>
+    {
+        static_assert(scopefn_internal::ContextCallable<const P, T&>,
+                      "Scope function `take_unless` argument type must match context object type");
+        return scopefn_internal::takeWhen(false, fun, contextObject);
+    }
+
+    P fun;
+};
 
 /**
- * @brief Freestanding with scope function. The with scope function accepts the
- * context object via lambda capture and returns the lambda result. The with
- * scope function only exists as freestanging and cannot be chained.
+ * @brief Freestanding traced let function. Same as `let`, but the given
+ * tracer is called around every call of the lambda, so the latency of the
+ * stage can be recorded.
  *
- * @example animal | with([self = &animal]{ self->doSomething(); });
+ * @example animal | let_traced(histogram, [](Animal& it){ return it.age; });
  *
+ * @tparam Tracer - tracer, a reference type for tracers passed as lvalues
  * @tparam L
  */
-template <typename L>
-struct with
+SCOPEFN_EXPORT template <typename Tracer, typename L>
+struct let_traced
 {
-    using RT = typename scopefn_internal::LambdaReflectionNoArg<L>::return_type;
-    with(L lambda) : fun(lambda) {std::invoke(*this);}
-    RT operator()() 
+    template<typename T>
+    constexpr auto operator()(T&& contextObject)
+        noexcept(std::is_nothrow_invocable_v<let<L>&, T> && scopefn_internal::nothrowTracer<decltype((tracer))>())
     {
-        return fun();
+        scopefn_internal::TraceScope<decltype((tracer))> trace(tracer, scopefn_internal::stageInfo<L>("let", location));
+        return stage(std::forward<T>(contextObject));
     }
 
-    std::function<RT(void)> fun;
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) const
+        noexcept(std::is_nothrow_invocable_v<const let<L>&, T> &&
+                 scopefn_internal::nothrowTracer<decltype((tracer))>())
+    {
+        scopefn_internal::TraceScope<decltype((tracer))> trace(tracer, scopefn_internal::stageInfo<L>("let", location));
+        return stage(std::forward<T>(contextObject));
+    }
+
+    Tracer tracer;
+    let<L> stage;
+    std::source_location location = std::source_location::current();
 };
 
+SCOPEFN_EXPORT template<typename Tracer, typename L>
+let_traced(Tracer&&, L) -> let_traced<Tracer, L>;
+
 /**
- * @brief Freestanding also function. The `also` scope function accepts the
- * context object as an argument and returns a reference to the same context
- * object.
+ * @brief Freestanding traced also function. Same as `also`, but the given
+ * tracer is called around every call of the lambda, so the latency of the
+ * stage can be recorded.
  *
- * @example animal | also([](Animal& it){ it.doSomething(); });
+ * @example animal | also_traced(histogram, [](Animal& it){ it.doSomething(); });
  *
+ * @tparam Tracer - tracer, a reference type for tracers passed as lvalues
  * @tparam L
  */
-template <typename L>
-struct also
+SCOPEFN_EXPORT template <typename Tracer, typename L>
+struct also_traced
+{
+    template<typename T>
+    constexpr T&& operator()(T&& contextObject)
+        noexcept(std::is_nothrow_invocable_v<also<L>&, T> && scopefn_internal::nothrowTracer<decltype((tracer))>())
+    {
+        scopefn_internal::TraceScope<decltype((tracer))> trace(tracer, scopefn_internal::stageInfo<L>("also", location));
+        return stage(std::forward<T>(contextObject));
+    }
+
+    template<typename T>
+    constexpr T&& operator()(T&& contextObject) const
+        noexcept(std::is_nothrow_invocable_v<const also<L>&, T> &&
+                 scopefn_internal::nothrowTracer<decltype((tracer))>())
+    {
+        scopefn_internal::TraceScope<decltype((tracer))> trace(tracer, scopefn_internal::stageInfo<L>("also", location));
+        return stage(std::forward<T>(contextObject));
+    }
+
+    Tracer tracer;
+    also<L> stage;
+    std::source_location location = std::source_location::current();
+};
+
+SCOPEFN_EXPORT template<typename Tracer, typename L>
+also_traced(Tracer&&, L) -> also_traced<Tracer, L>;
+
+SCOPEFN_EXPORT template <typename First, typename Second>
+struct pipeline;
+
+namespace scopefn_internal {
+
+/**
+ * @brief Helper struct marking the freestanding scope functions and
+ * pipelines, which can be placed on the right-hand side of operator|.
+ *
+ * @tparam T
+ */
+template<typename T>
+struct IsStage : std::false_type {};
+
+template<typename L, typename Projection>
+struct IsStage<let<L, Projection>> : std::true_type {};
+
+template<typename L>
+struct IsStage<run<L>> : std::true_type {};
+
+template<typename L, typename Projection>
+struct IsStage<also<L, Projection>> : std::true_type {};
+
+template<typename P>
+struct IsStage<take_if<P>> : std::true_type {};
+
+template<typename P>
+struct IsStage<take_unless<P>> : std::true_type {};
+
+template<typename Tracer, typename L>
+struct IsStage<let_traced<Tracer, L>> : std::true_type {};
+
+template<typename Tracer, typename L>
+struct IsStage<also_traced<Tracer, L>> : std::true_type {};
+
+template<typename First, typename Second>
+struct IsStage<pipeline<First, Second>> : std::true_type {};
+
+template<typename T>
+concept Stage = IsStage<base_type<T>>::value;
+
+/**
+ * @brief Satisfied by types which can be placed on the left-hand side of
+ * operator| as a context object. Overloads of operator| for special kinds of
+ * context objects constrain on this concept too, so they are more
+ * constrained than the generic one.
+ *
+ * @tparam T
+ */
+template<typename T>
+concept ContextObject = !Stage<T>;
+
+/**
+ * @brief Helper alias for the result of a pipeline. An rvalue reference may
+ * refer to a temporary created inside the pipeline, so it is turned into a
+ * value which is moved out of the pipeline.
+ *
+ * @tparam R - type returned by the last stage
+ */
+template<typename R>
+using stage_result =
+    std::conditional_t<std::is_rvalue_reference_v<R>, base_type<R>, R>;
+
+template<typename T>
+struct IsOptionalRef : std::false_type {};
+
+template<typename T>
+struct IsOptionalRef<optional_ref<T>> : std::true_type {};
+
+template<typename T>
+struct IsOptional : std::false_type {};
+
+template<typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+struct IsExpected : std::false_type {};
+
+#if __cpp_lib_expected
+template<typename T, typename E>
+struct IsExpected<std::expected<T, E>> : std::true_type {};
+#endif
+
+/**
+ * @brief Helper struct marking the stages which return the context object
+ * they are applied to, so chains over std::optional and std::expected pass the
+ * context object itself on instead of wrapping the payload again.
+ *
+ * @tparam T
+ */
+template<typename T>
+struct PreservesContext : std::false_type {};
+
+template<typename L, typename Projection>
+struct PreservesContext<also<L, Projection>> : std::true_type {};
+
+template<typename Tracer, typename L>
+struct PreservesContext<also_traced<Tracer, L>> : std::true_type {};
+
+template<typename First, typename Second>
+struct PreservesContext<pipeline<First, Second>>
+    : std::bool_constant<PreservesContext<First>::value && PreservesContext<Second>::value> {};
+
+/**
+ * @brief Helper struct telling whether callable F, a lambda, a pointer to
+ * member or a member function object, takes a context object of type T as
+ * it is. Pointers to members only take the objects std::invoke calls them on,
+ * not a std::optional holding one.
+ *
+ * @tparam F
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename F, typename T>
+struct TakesContext : std::bool_constant<ContextCallable<F, T>> {};
+
+template<auto Member, typename T>
+struct TakesContext<member<Member>, T> : std::is_invocable<decltype(Member), T> {};
+
+/**
+ * @brief Checks that lambda L takes a context object of type T as it is after
+ * the projection, which must take it as well.
+ *
+ * @tparam L
+ * @tparam Projection
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename L, typename Projection, typename T>
+constexpr bool projectedTakesContext()
 {
-    using ARG = typename scopefn_internal::LambdaReflection<L>::argument_type;
-    using RT = void;
-    also(L lambda) : fun(lambda) {}
-    ARG& operator()(ARG& contextObject) 
+    if constexpr (std::is_same_v<Projection, Identity>)
+        return TakesContext<L, T>::value;
+    else if constexpr (IsMember<Projection>::value || std::is_member_pointer_v<Projection>)
     {
-        fun(contextObject);
-        return contextObject;
+        if constexpr (TakesContext<Projection, T>::value)
+            return TakesContext<L, projected<Projection, T>>::value;
+        else
+            return false;
     }
+    else if constexpr (std::is_invocable_v<Projection&, T>)
+        return TakesContext<L, projected<Projection, T>>::value;
+    else
+        return false;
+}
+
+/**
+ * @brief Helper struct marking the stages which accept a context object of
+ * type T as it is. Chains over std::optional and std::expected only pass the
+ * payload to stages which don't, so stages written for the optional or the
+ * expected itself, and generic lambdas, keep receiving the wrapper. Stages
+ * ignoring the context object, like `run`, and pipelines, whose stages decide
+ * one by one, accept every context object.
+ *
+ * @tparam S - stage
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename S, typename T>
+struct AcceptsContext : std::false_type {};
+
+template<typename L, typename Projection, typename T>
+struct AcceptsContext<let<L, Projection>, T> : std::bool_constant<projectedTakesContext<L, Projection, T>()> {};
+
+template<typename L, typename T>
+struct AcceptsContext<run<L>, T> : std::true_type {};
+
+template<typename L, typename Projection, typename T>
+struct AcceptsContext<also<L, Projection>, T>
+    : std::bool_constant<projectedTakesContext<L, Projection, std::remove_reference_t<T>&>()> {};
 
-    std::function<RT(ARG &)> fun;
+template<typename P, typename T>
+struct AcceptsContext<take_if<P>, T> : TakesContext<P, std::remove_reference_t<T>&> {};
+
+template<typename P, typename T>
+struct AcceptsContext<take_unless<P>, T> : TakesContext<P, std::remove_reference_t<T>&> {};
+
+template<typename Tracer, typename L, typename T>
+struct AcceptsContext<let_traced<Tracer, L>, T> : AcceptsContext<let<L>, T> {};
+
+template<typename Tracer, typename L, typename T>
+struct AcceptsContext<also_traced<Tracer, L>, T> : AcceptsContext<also<L>, T> {};
+
+template<typename First, typename Second, typename T>
+struct AcceptsContext<pipeline<First, Second>, T> : std::true_type {};
+
+/**
+ * @brief Satisfied by context objects for which the following stages are
+ * skipped when they hold no value: optional references, std::optional and
+ * std::expected.
+ *
+ * @tparam T
+ */
+template<typename T>
+concept ShortCircuiting =
+    IsOptionalRef<base_type<T>>::value || IsOptional<base_type<T>>::value || IsExpected<base_type<T>>::value;
+
+/**
+ * @brief Satisfied when stage S is applied to the payload of a std::optional
+ * or std::expected context object of type T, because S doesn't accept the
+ * optional or expected itself.
+ *
+ * @tparam S - stage, const qualified for const pipelines
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename S, typename T>
+concept UnwrapsPayload =
+    (IsOptional<base_type<T>>::value || IsExpected<base_type<T>>::value) &&
+    !AcceptsContext<base_type<S>, T>::value;
+
+template<typename R>
+constexpr auto optionalStageResult()
+{
+    if constexpr (std::is_void_v<R> || IsOptionalRef<base_type<R>>::value || IsOptional<base_type<R>>::value)
+        return std::type_identity<base_type<R>>{};
+    else if constexpr (std::is_lvalue_reference_v<R>)
+        return std::type_identity<optional_ref<std::remove_reference_t<R>>>{};
+    else
+        return std::type_identity<std::optional<base_type<R>>>{};
+}
+
+/**
+ * @brief Helper alias for the result of applying a stage returning R to the
+ * referenced object of an optional reference. Optional results are returned
+ * as they are, so `take_if` stages can follow each other. References become
+ * optional references and values become std::optional.
+ *
+ * @tparam R - type returned by the stage
+ */
+template<typename R>
+using optional_stage_result = typename decltype(optionalStageResult<R>())::type;
+
+/**
+ * @brief Applies stage to a context object, as operator| and pipelines do.
+ *
+ * @tparam S - stage, const qualified for const pipelines
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename S, typename T>
+    requires (!IsOptionalRef<base_type<T>>::value && !UnwrapsPayload<S, T>)
+constexpr auto applyStage(S& stage, T&& contextObject)
+    noexcept(std::is_nothrow_invocable_v<S&, T>) -> std::invoke_result_t<S&, T>
+{
+    return stage(std::forward<T>(contextObject));
+}
+
+/**
+ * @brief Overload of applyStage for optional references, which applies stage
+ * to the referenced object if there is one and skips it otherwise.
+ *
+ * @tparam S - stage, const qualified for const pipelines
+ * @tparam T - type of optional reference, a reference type for lvalues
+ */
+template<typename S, typename T>
+    requires IsOptionalRef<base_type<T>>::value
+constexpr auto applyStage(S& stage, T&& contextObject)
+    noexcept(std::is_nothrow_invocable_v<S&, decltype(*contextObject)> &&
+             std::is_nothrow_convertible_v<std::invoke_result_t<S&, decltype(*contextObject)>,
+                                           optional_stage_result<std::invoke_result_t<S&, decltype(*contextObject)>>>)
+    -> optional_stage_result<std::invoke_result_t<S&, decltype(*contextObject)>>
+{
+    using Result = std::invoke_result_t<S&, decltype(*contextObject)>;
+    if constexpr (std::is_void_v<Result>)
+    {
+        if(contextObject)
+            stage(*contextObject);
+    }
+    else
+    {
+        using Optional = optional_stage_result<Result>;
+        if(!contextObject)
+            return Optional{};
+        return Optional(stage(*contextObject));
+    }
+}
+
+template<typename S, typename T>
+constexpr auto monadicStageResult()
+{
+    using Context = base_type<T>;
+    using Result = std::invoke_result_t<S&, decltype(*std::declval<T>())>;
+    if constexpr (PreservesContext<base_type<S>>::value)
+        return std::type_identity<stage_result<T&&>>{};
+    else if constexpr (IsOptional<Context>::value)
+        return std::type_identity<optional_stage_result<Result>>{};
+#if __cpp_lib_expected
+    else if constexpr (IsExpected<base_type<Result>>::value)
+        return std::type_identity<base_type<Result>>{};
+    else
+        return std::type_identity<std::expected<base_type<Result>, typename Context::error_type>>{};
+#endif
+}
+
+/**
+ * @brief Helper alias for the result of applying stage S to the payload of a
+ * std::optional or std::expected context object of type T. Stages returning
+ * the context object pass it on, other stages return a std::optional or a
+ * std::expected with the same error type of their result, unless the result
+ * already is one.
+ *
+ * @tparam S - stage, const qualified for const pipelines
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename S, typename T>
+using monadic_stage_result = typename decltype(monadicStageResult<S, T>())::type;
+
+/**
+ * @brief Overload of applyStage for std::optional and std::expected context
+ * objects passed to stages which don't accept them as they are. It applies
+ * stage to the payload if there is one and returns an empty optional or the
+ * error otherwise, without calling the stage. The
+ * payload of temporary context objects is passed on as an rvalue, so it is
+ * moved between stages instead of copied.
+ *
+ * @tparam S - stage, const qualified for const pipelines
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename S, typename T>
+    requires UnwrapsPayload<S, T>
+constexpr auto applyStage(S& stage, T&& contextObject)
+    noexcept(std::is_nothrow_invocable_v<S&, decltype(*std::forward<T>(contextObject))> &&
+             std::is_nothrow_constructible_v<base_type<T>, T> &&
+             std::is_nothrow_move_constructible_v<monadic_stage_result<S, T>>)
+    -> monadic_stage_result<S, T>
+{
+    using Result = std::invoke_result_t<S&, decltype(*std::forward<T>(contextObject))>;
+    using Monad = monadic_stage_result<S, T>;
+    if constexpr (PreservesContext<base_type<S>>::value)
+    {
+        if(contextObject)
+            stage(*std::forward<T>(contextObject));
+        return std::forward<T>(contextObject);
+    }
+    else if constexpr (std::is_void_v<Monad>)
+    {
+        if(contextObject)
+            stage(*std::forward<T>(contextObject));
+    }
+    else
+    {
+        if(!contextObject)
+        {
+            if constexpr (IsOptional<base_type<T>>::value)
+                return Monad{};
+#if __cpp_lib_expected
+            else
+            {
+                static_assert(std::is_same_v<typename Monad::error_type, typename base_type<T>::error_type>,
+                              "Scope functions chained over std::expected must keep its error type");
+                return Monad(std::unexpect, std::forward<T>(contextObject).error());
+            }
+#endif
+        }
+        if constexpr (std::is_same_v<Monad, base_type<Result>> || IsOptionalRef<Monad>::value)
+            return Monad(stage(*std::forward<T>(contextObject)));
+        else if constexpr (std::is_void_v<Result>)
+        {
+            stage(*std::forward<T>(contextObject));
+            return Monad{};
+        }
+        else
+            return Monad(std::in_place, stage(*std::forward<T>(contextObject)));
+    }
+}
+
+/**
+ * @brief Helper alias for the result of applying stage S to a context object
+ * of type T.
+ *
+ * @tparam S - stage, const qualified for const pipelines
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename S, typename T>
+using apply_result = decltype(applyStage(std::declval<S&>(), std::declval<T>()));
+
+/**
+ * @brief Helper alias for the result of applying stage First and then stage
+ * Second to a context object of type T.
+ *
+ * @tparam First - first stage, const qualified for const pipelines
+ * @tparam Second - second stage, const qualified for const pipelines
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename First, typename Second, typename T>
+using pipeline_result = stage_result<apply_result<Second, apply_result<First, T>>>;
+
+/**
+ * @brief True when applying stage First and then stage Second to a context
+ * object of type T cannot throw.
+ *
+ * @tparam First - first stage, const qualified for const pipelines
+ * @tparam Second - second stage, const qualified for const pipelines
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename First, typename Second, typename T>
+inline constexpr bool is_nothrow_pipeline =
+    noexcept(applyStage(std::declval<First&>(), std::declval<T>())) &&
+    noexcept(applyStage(std::declval<Second&>(), std::declval<apply_result<First, T>>())) &&
+    std::is_nothrow_convertible_v<apply_result<Second, apply_result<First, T>>,
+                                  pipeline_result<First, Second, T>>;
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Composition of two freestanding scope functions. A pipeline is built
+ * by chaining scope functions without a context object on the left, it can be
+ * stored and applied to any number of context objects. Applying a pipeline
+ * calls the stages directly one after the other, without creating the
+ * intermediate let/also wrapper structs again for every context object.
+ *
+ * @example auto older = also([](Person& it){ it.incrementAge(); })
+ *                     | let([](Person& it){ return it.age; });
+ *          unsigned age = person | older;
+ *
+ * @tparam First - first stage
+ * @tparam Second - second stage
+ */
+template <typename First, typename Second>
+struct pipeline
+{
+    template<typename T>
+    constexpr auto operator()(T&& contextObject)
+        noexcept(scopefn_internal::is_nothrow_pipeline<First, Second, T>)
+        -> scopefn_internal::pipeline_result<First, Second, T>
+    {
+        return scopefn_internal::applyStage(
+            second, scopefn_internal::applyStage(first, std::forward<T>(contextObject)));
+    }
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) const
+        noexcept(scopefn_internal::is_nothrow_pipeline<const First, const Second, T>)
+        -> scopefn_internal::pipeline_result<const First, const Second, T>
+    {
+        return scopefn_internal::applyStage(
+            second, scopefn_internal::applyStage(first, std::forward<T>(contextObject)));
+    }
+
+    First first;
+    Second second;
 };
 
 /**
- * @brief Chaining operator for the freestanding also function.
+ * @brief Chaining operator applying a freestanding scope function or a
+ * pipeline to a context object. Temporary context objects are forwarded as
+ * rvalues, so they can be moved through the chain without being copied.
+ * The `let` and `run` functions return the lambda result, the `also` function
+ * returns the context object as T& for lvalues and as T&& for temporaries.
  * 
+ * @example animal | also([](Animal& it){ it.doSomething(); });
+ *
  * @tparam T 
- * @tparam L 
+ * @tparam S 
  * @param contextObject 
- * @param lambda 
- * @return also<L>::ARG& 
+ * @param stage 
+ * @return decltype(auto)
  */
-template<typename T, typename L>
-auto operator|(T& contextObject, also<L>&& lambda) -> typename also<L>::ARG&
+SCOPEFN_EXPORT template<scopefn_internal::ContextObject T, scopefn_internal::Stage S>
+constexpr auto operator|(T&& contextObject, S&& stage)
+    noexcept(noexcept(scopefn_internal::applyStage(stage, std::forward<T>(contextObject)))) -> decltype(auto)
 {
-    static_assert(std::is_same_v<T, typename also<L>::ARG>,
-                  "Scope function `also` argument type must match return type "
-                  "which is the context object type");
-    return lambda(contextObject);
+    return scopefn_internal::applyStage(stage, std::forward<T>(contextObject));
 }
 
 /**
- * @brief Chaining operator for the freestanding also function.
- * 
- * @tparam T 
- * @tparam L 
- * @param contextObject 
- * @param lambda 
- * @return also<L>::ARG& 
+ * @brief Chaining operator composing two freestanding scope functions or
+ * pipelines into a single pipeline.
+ *
+ * @example auto stages = let(f) | let(g) | also(h);
+ *
+ * @tparam First
+ * @tparam Second
+ * @param first
+ * @param second
+ * @return pipeline<First, Second>
  */
-template<typename T, typename L>
-auto operator|(T&& contextObject, also<L>&& lambda) -> typename also<L>::ARG&
+SCOPEFN_EXPORT template<scopefn_internal::Stage First, scopefn_internal::Stage Second>
+constexpr auto operator|(First&& first, Second&& second)
+    noexcept(std::is_nothrow_constructible_v<scopefn_internal::base_type<First>, First> &&
+             std::is_nothrow_constructible_v<scopefn_internal::base_type<Second>, Second>)
+    -> pipeline<scopefn_internal::base_type<First>, scopefn_internal::base_type<Second>>
 {
-    static_assert(std::is_same_v<T, typename also<L>::ARG>,
-                  "Scope function `also` argument type must match return type "
-                  "which is the context object type");
-    return lambda(contextObject);
+    return {std::forward<First>(first), std::forward<Second>(second)};
 }
 
 } // namespace scopefn
 
-#endif
\ No newline at end of file
+#endif
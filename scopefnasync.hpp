@@ -0,0 +1,698 @@
+#ifndef _SCOPEFN_ASYNC_H
+#define _SCOPEFN_ASYNC_H
+
+#include "scopefn.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace scopefn {
+
+/**
+ * @brief Executor running every task on a new detached thread. Any type with
+ * an `execute` member function accepting a move-only nullary callable, like a
+ * thread pool handle, can be used as an executor instead. Creating a thread
+ * per task is expensive and detached threads may outlive the statics they
+ * use, so prefer shared_pool_executor outside of tests.
+ */
+struct thread_executor
+{
+    template<typename Task>
+    void execute(Task&& task) const
+    {
+        std::thread(std::forward<Task>(task)).detach();
+    }
+};
+
+namespace scopefn_internal {
+
+/**
+ * @brief Type erased task of the shared pool. The callable follows the header
+ * in the same allocation and is reached through the function pointer, which
+ * runs the callable and deletes the task, so there are no virtual functions.
+ * Callables with a `ready` member function, like the tasks of asynchronous
+ * scope functions chained on a future, only run once it returns true. Until
+ * then the function pointer returns false after waiting up to the given time,
+ * and the pool queues the task again instead of blocking a worker on it.
+ */
+struct PoolTask
+{
+    bool (*runAndDelete)(PoolTask*, std::chrono::microseconds wait) noexcept;
+};
+
+template<typename F>
+struct PoolTaskNode : PoolTask
+{
+    explicit PoolTaskNode(F&& callable) : PoolTask{&runTask}, fun(std::move(callable)) {}
+    explicit PoolTaskNode(const F& callable) : PoolTask{&runTask}, fun(callable) {}
+
+    static bool runTask(PoolTask* task, std::chrono::microseconds wait) noexcept
+    {
+        auto* node = static_cast<PoolTaskNode*>(task);
+        if constexpr (requires { node->fun.ready(wait); })
+        {
+            if(!node->fun.ready(wait))
+                return false;
+        }
+        node->fun();
+        delete node;
+        return true;
+    }
+
+    F fun;
+};
+
+/**
+ * @brief Work-stealing thread pool behind shared_pool_executor, created on
+ * first use with one worker per hardware thread. Every worker owns a task
+ * queue: tasks submitted by a worker go to its own queue, other tasks are
+ * spread over the queues round-robin. Workers take the newest task of their
+ * own queue and steal the oldest task of the others when it is empty. A task
+ * waiting for a future which isn't ready goes back to the oldest end of the
+ * queue, so a worker never blocks on a task queued behind it. The pool is
+ * destroyed with the other statics, after running the queued tasks and
+ * joining the workers.
+ */
+struct WorkStealingPool
+{
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<PoolTask*> tasks;
+    };
+
+    static WorkStealingPool& instance()
+    {
+        static WorkStealingPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+    explicit WorkStealingPool(unsigned threads) : queues(threads)
+    {
+        workers.reserve(threads);
+        for(unsigned worker = 0; worker < threads; worker++)
+            workers.emplace_back([this, worker] { work(worker); });
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(std::thread& worker : workers)
+            worker.join();
+    }
+
+    void push(PoolTask* task, bool oldest = false)
+    {
+        // Counted before it is queued, so a worker taking it never sees the
+        // count drop below zero
+        {
+            std::lock_guard lock(sleepMutex);
+            pending++;
+        }
+        Queue& queue = currentPool == this ? queues[currentWorker]
+                                            : queues[nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+        {
+            std::lock_guard lock(queue.mutex);
+            if(oldest)
+                queue.tasks.push_front(task);
+            else
+                queue.tasks.push_back(task);
+        }
+        wake.notify_one();
+    }
+
+    void run(PoolTask* task)
+    {
+        // With nothing else queued the worker waits a little for the future
+        // of a task which isn't ready, rather than spinning on it
+        const auto wait = pending.load(std::memory_order_relaxed) == 0 ? std::chrono::microseconds(100)
+                                                                      : std::chrono::microseconds(0);
+        if(!task->runAndDelete(task, wait))
+            push(task, true);
+    }
+
+    PoolTask* take(std::size_t worker)
+    {
+        for(std::size_t offset = 0; offset < queues.size(); offset++)
+        {
+            Queue& queue = queues[(worker + offset) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if(queue.tasks.empty())
+                continue;
+            PoolTask* task;
+            if(offset == 0)
+            {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+        return nullptr;
+    }
+
+    void work(std::size_t worker)
+    {
+        currentPool = this;
+        currentWorker = worker;
+        for(;;)
+        {
+            if(PoolTask* task = take(worker))
+            {
+                run(task);
+                continue;
+            }
+            std::unique_lock lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || pending.load(std::memory_order_relaxed) > 0; });
+            if(stopping && pending.load(std::memory_order_relaxed) == 0)
+                return;
+        }
+    }
+
+    static inline thread_local WorkStealingPool* currentPool = nullptr;
+    static inline thread_local std::size_t currentWorker = 0;
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<std::size_t> pending = 0;
+    std::atomic<std::size_t> nextQueue = 0;
+    bool stopping = false;
+};
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Executor running tasks on a process-wide work-stealing thread pool,
+ * which is created on first use and joined when the program exits. It is the
+ * default executor of `also_parallel`. Tasks must not throw, the task
+ * wrappers of the asynchronous scope functions pass exceptions on through
+ * their futures instead.
+ */
+struct shared_pool_executor
+{
+    template<typename Task>
+    void execute(Task&& task) const
+    {
+        using Node = scopefn_internal::PoolTaskNode<scopefn_internal::base_type<Task>>;
+        scopefn_internal::WorkStealingPool::instance().push(new Node(std::forward<Task>(task)));
+    }
+};
+
+namespace scopefn_internal {
+
+/**
+ * @brief Satisfied by types with an `execute` member function accepting a
+ * nullary callable.
+ *
+ * @tparam E
+ */
+template<typename E>
+concept Executor = requires(base_type<E>& executor) { executor.execute([] {}); };
+
+template<typename T>
+struct IsFuture : std::false_type {};
+
+template<typename T>
+struct IsFuture<std::future<T>> : std::true_type {};
+
+/**
+ * @brief Holds the context object of an asynchronous scope function until
+ * the task runs. Lvalue context objects are held by reference and must
+ * outlive the task, temporaries are moved into the task and futures are
+ * waited for on the executor. `ready` tells whether `get` would block, so the
+ * shared pool only runs the task once the future is ready.
+ *
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename T>
+struct ContextHolder
+{
+    T& get() { return *contextObject; }
+    bool ready(std::chrono::microseconds) const noexcept { return true; }
+    std::remove_reference_t<T>* contextObject;
+};
+
+template<typename T>
+    requires (!std::is_reference_v<T>)
+struct ContextHolder<T>
+{
+    T&& get() { return std::move(contextObject); }
+    bool ready(std::chrono::microseconds) const noexcept { return true; }
+    T contextObject;
+};
+
+template<typename T>
+struct ContextHolder<std::future<T>>
+{
+    T get() { return contextObject.get(); }
+    bool ready(std::chrono::microseconds wait) const { return contextObject.wait_for(wait) == std::future_status::ready; }
+    std::future<T> contextObject;
+};
+
+template<typename T>
+struct ContextHolder<std::future<T&>>
+{
+    T& get() { return contextObject.get(); }
+    bool ready(std::chrono::microseconds wait) const { return contextObject.wait_for(wait) == std::future_status::ready; }
+    std::future<T&> contextObject;
+};
+
+template<typename T>
+auto holdContext(T&& contextObject) -> ContextHolder<std::conditional_t<std::is_lvalue_reference_v<T>, T, base_type<T>>>
+{
+    if constexpr (std::is_lvalue_reference_v<T>)
+    {
+        static_assert(!IsFuture<base_type<T>>::value,
+                      "Asynchronous scope functions take ownership of futures, "
+                      "pass them as rvalues with std::move");
+        return {&contextObject};
+    }
+    else
+        return {std::move(contextObject)};
+}
+
+/**
+ * @brief Helper alias for the type the context object of type T is passed to
+ * a task as, after waiting for it if it is a future.
+ *
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename T>
+using async_context = decltype(holdContext(std::declval<T>()).get());
+
+/**
+ * @brief Task of an asynchronous scope function, which runs work with the
+ * context object and passes the result, or the exception work throws, to the
+ * promise. `ready` lets the shared pool hold the task back until a future
+ * context object is ready.
+ *
+ * @tparam Result - result of work
+ * @tparam Work - callable accepting the context object
+ * @tparam Holder - context holder
+ */
+template<typename Result, typename Work, typename Holder>
+struct AsyncTask
+{
+    void operator()()
+    {
+        try
+        {
+            if constexpr (std::is_void_v<Result>)
+            {
+                work(holder.get());
+                promise.set_value();
+            }
+            else
+                promise.set_value(work(holder.get()));
+        }
+        catch(...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+    }
+
+    bool ready(std::chrono::microseconds wait) const { return holder.ready(wait); }
+
+    std::promise<Result> promise;
+    Work work;
+    Holder holder;
+};
+
+/**
+ * @brief Runs work with the context object on executor. The returned future
+ * receives the result of work, or the exception it throws.
+ *
+ * @tparam E - executor
+ * @tparam Work - callable accepting the context object
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename E, typename Work, typename T>
+auto submit(E& executor, Work work, T&& contextObject)
+{
+    using Context = async_context<T>;
+    using Result = std::invoke_result_t<Work&, Context>;
+    using Holder = decltype(holdContext(std::forward<T>(contextObject)));
+
+    std::promise<Result> promise;
+    std::future<Result> future = promise.get_future();
+    executor.execute(AsyncTask<Result, Work, Holder>{std::move(promise), std::move(work),
+                                                     holdContext(std::forward<T>(contextObject))});
+    return future;
+}
+
+/**
+ * @brief Submits lambda with the context object to executor and returns a
+ * future of the lambda result. The lambda is copied into the task, so the
+ * task doesn't refer to the scope function that created it.
+ *
+ * @tparam E - executor
+ * @tparam L
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename E, typename L, typename T>
+auto letAsync(E& executor, const L& lambda, T&& contextObject)
+{
+    static_assert(ContextCallable<const L, async_context<T>>,
+                  "Scope function `let_async` argument type must match context object type");
+    return submit(
+        executor,
+        [lambda](auto&& context)
+        { return scopefn_internal::invoke(lambda, static_cast<context_argument<const L, decltype(context)>>(context)); },
+        std::forward<T>(contextObject));
+}
+
+/**
+ * @brief Submits lambda with the context object to executor and returns a
+ * future of the context object, a reference for lvalue context objects.
+ *
+ * @tparam E - executor
+ * @tparam L
+ * @tparam T - type of context object, a reference type for lvalues
+ */
+template<typename E, typename L, typename T>
+auto alsoAsync(E& executor, const L& lambda, T&& contextObject)
+{
+    using Context = async_context<T>;
+    static_assert(ContextCallable<const L, Context&>,
+                  "Scope function `also_async` argument type must match context object type");
+    return submit(
+        executor,
+        [lambda](Context context) -> stage_result<Context&&>
+        {
+            scopefn_internal::invoke(lambda, context);
+            return std::forward<Context>(context);
+        },
+        std::forward<T>(contextObject));
+}
+
+/**
+ * @brief Shared state of a parallel fan-out. Tasks are claimed by index, so
+ * each one runs exactly once, either on the executor or on the calling thread.
+ * Helpers may start after the fan-out has returned, so the state is shared
+ * with them and they only touch the lambdas after claiming a task.
+ */
+struct FanOutState
+{
+    explicit FanOutState(std::size_t tasks) : remaining(std::ptrdiff_t(tasks)) {}
+
+    std::atomic<std::size_t> next = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr exception;
+    std::latch remaining;
+};
+
+/**
+ * @brief Runs every lambda of lambdas with the context object concurrently
+ * and returns when all of them are done. One helper per lambda but the first
+ * is submitted to executor, and the calling thread claims tasks as well, so
+ * tasks the executor hasn't started yet are picked up by the calling thread
+ * instead of waited for. The first exception thrown by a lambda is rethrown
+ * after all lambdas are done.
+ *
+ * @tparam E - executor
+ * @tparam Tuple - tuple of lambdas
+ * @tparam Context - type passed to the lambdas, a reference type
+ */
+template<typename Context, typename E, typename Tuple>
+void fanOut(E& executor, Tuple& lambdas, Context contextObject)
+{
+    constexpr std::size_t tasks = std::tuple_size_v<Tuple>;
+    auto state = std::make_shared<FanOutState>(tasks);
+    auto drain = [&lambdas, &contextObject](FanOutState& shared)
+    {
+        for(std::size_t task; (task = shared.next.fetch_add(1, std::memory_order_relaxed)) < tasks;)
+        {
+            try
+            {
+                [&]<std::size_t... I>(std::index_sequence<I...>)
+                {
+                    ((task == I ? (void)scopefn_internal::invoke(std::get<I>(lambdas), contextObject) : void()), ...);
+                }(std::make_index_sequence<tasks>());
+            }
+            catch(...)
+            {
+                if(!shared.failed.exchange(true, std::memory_order_relaxed))
+                    shared.exception = std::current_exception();
+            }
+            shared.remaining.count_down();
+        }
+    };
+
+    try
+    {
+        for(std::size_t helper = 1; helper < tasks; helper++)
+            executor.execute([state, drain] { drain(*state); });
+    }
+    catch(...)
+    {
+        // The remaining tasks run on the calling thread, but submitted ones
+        // may already be running and must be waited for
+    }
+    drain(*state);
+    state->remaining.wait();
+    if(state->exception)
+        std::rethrow_exception(state->exception);
+}
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Freestanding asynchronous let function. The `let_async` scope
+ * function runs the lambda with the context object on the given executor and
+ * returns a std::future of the lambda result. Lvalue context objects are
+ * passed by reference and must outlive the returned future, temporaries are
+ * moved into the task. A future on the left of operator| is waited for on the
+ * executor, so asynchronous stages can be chained without blocking the
+ * calling thread. The shared pool runs the task once the future is ready, so
+ * chained stages don't block its workers.
+ *
+ * @example std::future<size_t> size = vec | let_async(pool, [](std::vector<int>& it){ return it.size(); });
+ *
+ * @tparam E - executor, a reference type for executors passed as lvalues
+ * @tparam L
+ */
+template <typename E, typename L>
+struct let_async
+{
+    template<typename T>
+    auto operator()(T&& contextObject)
+    {
+        return scopefn_internal::letAsync(executor, fun, std::forward<T>(contextObject));
+    }
+
+    template<typename T>
+    auto operator()(T&& contextObject) const
+    {
+        return scopefn_internal::letAsync(executor, fun, std::forward<T>(contextObject));
+    }
+
+    E executor;
+    L fun;
+};
+
+template<scopefn_internal::Executor E, typename L>
+let_async(E&&, L) -> let_async<E, L>;
+
+/**
+ * @brief Freestanding asynchronous also function. The `also_async` scope
+ * function runs the lambda with the context object on the given executor and
+ * returns a std::future of the context object. Lvalue context objects are
+ * passed by reference and must outlive the returned future, which then holds
+ * a reference to them. Temporaries are moved into the task and moved out into
+ * the future.
+ *
+ * @example std::future<Animal&> fed = animal | also_async(pool, [](Animal& it){ it.feed(); });
+ *
+ * @tparam E - executor, a reference type for executors passed as lvalues
+ * @tparam L
+ */
+template <typename E, typename L>
+struct also_async
+{
+    template<typename T>
+    auto operator()(T&& contextObject)
+    {
+        return scopefn_internal::alsoAsync(executor, fun, std::forward<T>(contextObject));
+    }
+
+    template<typename T>
+    auto operator()(T&& contextObject) const
+    {
+        return scopefn_internal::alsoAsync(executor, fun, std::forward<T>(contextObject));
+    }
+
+    E executor;
+    L fun;
+};
+
+template<scopefn_internal::Executor E, typename L>
+also_async(E&&, L) -> also_async<E, L>;
+
+/**
+ * @brief Freestanding parallel also function. The `also_parallel` scope
+ * function runs several lambdas with the same context object concurrently and
+ * returns a reference to the context object once all of them are done, like
+ * a chain of `also` calls which overlap. The lambdas run on the given
+ * executor, the shared work-stealing pool by default, and on the calling
+ * thread, which picks up every lambda the executor hasn't started yet, so a
+ * busy pool doesn't stall the chain. The lambdas must not race on the context
+ * object, use `also_parallel_const` to have that enforced.
+ *
+ * @example request | also_parallel(logIt, indexIt, cacheIt);
+ * @example request | also_parallel(pool, logIt, indexIt, cacheIt);
+ *
+ * @tparam E - executor, a reference type for executors passed as lvalues
+ * @tparam L - lambdas
+ */
+template <typename E, typename... L>
+struct also_parallel
+{
+    constexpr also_parallel(L... lambdas) requires std::is_same_v<E, shared_pool_executor>
+        : funs(std::move(lambdas)...) {}
+
+    template<typename Executor>
+    constexpr also_parallel(Executor&& stageExecutor, L... lambdas)
+        : executor(std::forward<Executor>(stageExecutor)), funs(std::move(lambdas)...) {}
+
+    template<typename T>
+    scopefn_internal::stage_result<T&&> operator()(T&& contextObject)
+    {
+        static_assert((scopefn_internal::ContextCallable<L, std::remove_reference_t<T>&> && ...),
+                      "Scope function `also_parallel` argument types must match context object type");
+        scopefn_internal::fanOut<std::remove_reference_t<T>&>(executor, funs, contextObject);
+        return std::forward<T>(contextObject);
+    }
+
+    template<typename T>
+    scopefn_internal::stage_result<T&&> operator()(T&& contextObject) const
+    {
+        static_assert((scopefn_internal::ContextCallable<const L, std::remove_reference_t<T>&> && ...),
+                      "Scope function `also_parallel` argument types must match context object type");
+        scopefn_internal::fanOut<std::remove_reference_t<T>&>(executor, funs, contextObject);
+        return std::forward<T>(contextObject);
+    }
+
+    E executor;
+    std::tuple<L...> funs;
+};
+
+template<typename F, typename... L>
+    requires (!scopefn_internal::Executor<F>)
+also_parallel(F, L...) -> also_parallel<shared_pool_executor, F, L...>;
+
+template<scopefn_internal::Executor E, typename... L>
+also_parallel(E&&, L...) -> also_parallel<E, L...>;
+
+/**
+ * @brief Same as `also_parallel`, but the lambdas receive the context object
+ * as a const reference, so that they can't race on modifying it. Lambdas
+ * accepting a non-const reference are rejected at compile time.
+ *
+ * @example request | also_parallel_const([](const Request& it){ log(it); }, [](const Request& it){ index(it); });
+ *
+ * @tparam E - executor, a reference type for executors passed as lvalues
+ * @tparam L - lambdas
+ */
+template <typename E, typename... L>
+struct also_parallel_const
+{
+    constexpr also_parallel_const(L... lambdas) requires std::is_same_v<E, shared_pool_executor>
+        : funs(std::move(lambdas)...) {}
+
+    template<typename Executor>
+    constexpr also_parallel_const(Executor&& stageExecutor, L... lambdas)
+        : executor(std::forward<Executor>(stageExecutor)), funs(std::move(lambdas)...) {}
+
+    template<typename T>
+    scopefn_internal::stage_result<T&&> operator()(T&& contextObject)
+    {
+        static_assert((scopefn_internal::ContextCallable<L, const std::remove_reference_t<T>&> && ...),
+                      "Scope function `also_parallel_const` lambdas must accept "
+                      "the context object as a const reference");
+        scopefn_internal::fanOut<const std::remove_reference_t<T>&>(executor, funs, contextObject);
+        return std::forward<T>(contextObject);
+    }
+
+    template<typename T>
+    scopefn_internal::stage_result<T&&> operator()(T&& contextObject) const
+    {
+        static_assert((scopefn_internal::ContextCallable<const L, const std::remove_reference_t<T>&> && ...),
+                      "Scope function `also_parallel_const` lambdas must accept "
+                      "the context object as a const reference");
+        scopefn_internal::fanOut<const std::remove_reference_t<T>&>(executor, funs, contextObject);
+        return std::forward<T>(contextObject);
+    }
+
+    E executor;
+    std::tuple<L...> funs;
+};
+
+template<typename F, typename... L>
+    requires (!scopefn_internal::Executor<F>)
+also_parallel_const(F, L...) -> also_parallel_const<shared_pool_executor, F, L...>;
+
+template<scopefn_internal::Executor E, typename... L>
+also_parallel_const(E&&, L...) -> also_parallel_const<E, L...>;
+
+namespace scopefn_internal {
+
+template<typename E, typename L>
+struct IsStage<let_async<E, L>> : std::true_type {};
+
+template<typename E, typename L>
+struct IsStage<also_async<E, L>> : std::true_type {};
+
+template<typename E, typename... L>
+struct IsStage<also_parallel<E, L...>> : std::true_type {};
+
+template<typename E, typename... L>
+struct IsStage<also_parallel_const<E, L...>> : std::true_type {};
+
+template<typename E, typename... L>
+struct PreservesContext<also_parallel<E, L...>> : std::true_type {};
+
+template<typename E, typename... L>
+struct PreservesContext<also_parallel_const<E, L...>> : std::true_type {};
+
+template<typename E, typename L, typename T>
+struct AcceptsContext<let_async<E, L>, T> : TakesContext<L, T> {};
+
+template<typename E, typename L, typename T>
+struct AcceptsContext<also_async<E, L>, T> : TakesContext<L, std::remove_reference_t<T>&> {};
+
+template<typename E, typename... L, typename T>
+struct AcceptsContext<also_parallel<E, L...>, T>
+    : std::conjunction<TakesContext<L, std::remove_reference_t<T>&>...> {};
+
+template<typename E, typename... L, typename T>
+struct AcceptsContext<also_parallel_const<E, L...>, T>
+    : std::conjunction<TakesContext<L, const std::remove_reference_t<T>&>...> {};
+
+} // namespace scopefn_internal
+
+} // namespace scopefn
+
+#endif
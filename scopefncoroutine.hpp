@@ -0,0 +1,255 @@
+#ifndef _SCOPEFN_COROUTINE_H
+#define _SCOPEFN_COROUTINE_H
+
+#include "scopefn.hpp"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <tuple>
+
+namespace scopefn {
+
+namespace scopefn_internal {
+
+/**
+ * @brief Returns the awaiter used when awaitable is co_awaited, following
+ * the lookup of the co_await operator.
+ *
+ * @tparam A - type of awaitable, a reference type for lvalues
+ */
+template<typename A>
+decltype(auto) getAwaiter(A&& awaitable)
+{
+    if constexpr (requires { std::forward<A>(awaitable).operator co_await(); })
+        return std::forward<A>(awaitable).operator co_await();
+    else if constexpr (requires { operator co_await(std::forward<A>(awaitable)); })
+        return operator co_await(std::forward<A>(awaitable));
+    else
+        return std::forward<A>(awaitable);
+}
+
+/**
+ * @brief Satisfied by types which can be co_awaited.
+ *
+ * @tparam T
+ */
+template<typename T>
+concept Awaitable = requires(std::remove_reference_t<decltype(getAwaiter(std::declval<T>()))>& awaiter)
+{
+    awaiter.await_ready();
+    awaiter.await_resume();
+};
+
+/**
+ * @brief Helper alias for the type produced by co_awaiting an awaitable of
+ * type A.
+ *
+ * @tparam A - type of awaitable, a reference type for lvalues
+ */
+template<typename A>
+using await_result = decltype(getAwaiter(std::declval<A>()).await_resume());
+
+/**
+ * @brief Helper alias for the result of applying stage S to the result of
+ * co_awaiting an awaitable of type A.
+ *
+ * @tparam A - type of awaitable, a reference type for lvalues
+ * @tparam S - stage
+ */
+template<typename A, typename S>
+using awaited_stage_result = stage_result<apply_result<S, await_result<A>>>;
+
+/**
+ * @brief True when applying stage S to the result of co_awaiting an
+ * awaitable of type A returns an optional reference to that result, like
+ * `take_if` does, while the result is a temporary. The awaitable chain then
+ * keeps the result alive until the whole chain has been co_awaited.
+ *
+ * @tparam A - type of awaitable, a reference type for lvalues
+ * @tparam S - stage
+ */
+template<typename A, typename S>
+inline constexpr bool keeps_awaited_result =
+    !std::is_reference_v<await_result<A>> &&
+    IsOptionalRef<base_type<apply_result<S, await_result<A>>>>::value;
+
+template<typename T>
+struct ChainTaskResult
+{
+    void return_value(T value) { result.emplace(std::move(value)); }
+    T get() { return std::move(*result); }
+    std::optional<T> result;
+};
+
+template<typename T>
+struct ChainTaskResult<T&>
+{
+    void return_value(T& value) { result = &value; }
+    T& get() { return *result; }
+    T* result = nullptr;
+};
+
+template<>
+struct ChainTaskResult<void>
+{
+    void return_void() {}
+    void get() {}
+};
+
+/**
+ * @brief Lazy coroutine joining two awaitables, used when a stage applied to
+ * an awaited result returns an awaitable itself. It starts when co_awaited and
+ * resumes the awaiting coroutine by symmetric transfer when it is done.
+ *
+ * @tparam T - type produced by co_awaiting the task
+ */
+template<typename T>
+struct ChainTask
+{
+    struct promise_type : ChainTaskResult<T>
+    {
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            {
+                return handle.promise().continuation;
+            }
+            void await_resume() noexcept {}
+        };
+
+        ChainTask get_return_object() { return ChainTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+    };
+
+    struct Awaiter
+    {
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+        T await_resume()
+        {
+            if(handle.promise().exception)
+                std::rethrow_exception(handle.promise().exception);
+            return handle.promise().get();
+        }
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    explicit ChainTask(std::coroutine_handle<promise_type> coroutine) noexcept : handle(coroutine) {}
+    ChainTask(ChainTask&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    ChainTask& operator=(ChainTask&&) = delete;
+    ~ChainTask()
+    {
+        if(handle)
+            handle.destroy();
+    }
+
+    Awaiter operator co_await() && noexcept { return {handle}; }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * @brief Co_awaits awaitable, applies stage to the result and co_awaits the
+ * awaitable returned by the stage. The awaitable is taken by reference when
+ * it is an lvalue and must outlive the returned task.
+ *
+ * @tparam A - type of awaitable, a reference type for lvalues
+ * @tparam S - stage
+ */
+template<typename A, typename S>
+auto awaitThen(A awaitable, S stage)
+    -> ChainTask<stage_result<await_result<awaited_stage_result<A, S>>>>
+{
+    co_return co_await applyStage(stage, co_await std::forward<A>(awaitable));
+}
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Awaitable applying a freestanding scope function or a pipeline to
+ * the result of another awaitable. It is what operator| returns for an
+ * awaitable context object, so the chain can be co_awaited as a whole and
+ * suspends where the wrapped awaitable does. The awaiter is stored inline,
+ * so chaining doesn't allocate. Like operator|, it unwraps std::optional,
+ * std::expected and optional references for stages which don't accept them.
+ *
+ * @example unsigned age = co_await (fetchPerson() | also(log) | let([](Person& it){ return it.age; }));
+ *
+ * @tparam A - type of awaitable, a reference type for lvalues
+ * @tparam S - stage
+ */
+template <typename A, typename S>
+struct awaitable_chain
+{
+    struct Awaiter
+    {
+        using Awaited = scopefn_internal::await_result<A>;
+
+        bool await_ready() { return inner.await_ready(); }
+
+        template<typename Handle>
+        decltype(auto) await_suspend(Handle handle) { return inner.await_suspend(handle); }
+
+        scopefn_internal::awaited_stage_result<A, S> await_resume()
+        {
+            if constexpr (scopefn_internal::keeps_awaited_result<A, S>)
+                return scopefn_internal::applyStage(stage, std::move(awaited.emplace(inner.await_resume())));
+            else
+                return scopefn_internal::applyStage(stage, inner.await_resume());
+        }
+
+        S& stage;
+        decltype(scopefn_internal::getAwaiter(std::declval<A>())) inner;
+        [[no_unique_address]] std::conditional_t<scopefn_internal::keeps_awaited_result<A, S>,
+                                                 std::optional<Awaited>, std::tuple<>> awaited{};
+    };
+
+    Awaiter operator co_await() &&
+    {
+        return {stage, scopefn_internal::getAwaiter(std::forward<A>(awaitable))};
+    }
+
+    A awaitable;
+    S stage;
+};
+
+/**
+ * @brief Chaining operator for awaitable context objects, like the result of
+ * a `let` lambda returning a coroutine task. The stage is applied to the
+ * awaited result when the chain is co_awaited. If the stage returns an
+ * awaitable itself, it is co_awaited as well, so every asynchronous step of a
+ * chain suspends the awaiting coroutine.
+ *
+ * @example co_await (request | let(fetchUser) | also(log));
+ *
+ * @tparam A
+ * @tparam S
+ * @param awaitable
+ * @param stage
+ * @return awaitable_chain<A, S> or a task co_awaiting the stage result
+ */
+template<scopefn_internal::ContextObject A, scopefn_internal::Stage S>
+    requires scopefn_internal::Awaitable<A>
+auto operator|(A&& awaitable, S&& stage)
+{
+    using Stage = scopefn_internal::base_type<S>;
+    if constexpr (scopefn_internal::Awaitable<scopefn_internal::awaited_stage_result<A, Stage>>)
+        return scopefn_internal::awaitThen<A, Stage>(std::forward<A>(awaitable), std::forward<S>(stage));
+    else
+        return awaitable_chain<A, Stage>{std::forward<A>(awaitable), std::forward<S>(stage)};
+}
+
+} // namespace scopefn
+
+#endif
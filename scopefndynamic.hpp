@@ -0,0 +1,203 @@
+#ifndef _SCOPEFN_DYNAMIC_H
+#define _SCOPEFN_DYNAMIC_H
+
+#include "scopefn.hpp"
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+namespace scopefn {
+
+namespace scopefn_internal {
+
+/**
+ * @brief Type erased stage of a dynamic_pipeline. The stage object follows
+ * the header in the same allocation and is reached through the function
+ * pointers, so there are no virtual functions. The nodes form a singly linked
+ * list; allocated from a monotonic arena they are laid out one after another.
+ *
+ * @tparam T - type of context object
+ */
+template<typename T>
+struct DynamicStage
+{
+    void (*apply)(DynamicStage&, T&);
+    void (*destroy)(DynamicStage&, std::pmr::memory_resource&) noexcept;
+    DynamicStage* next = nullptr;
+};
+
+/**
+ * @brief Node storing a stage of type S behind its DynamicStage header.
+ *
+ * @tparam T - type of context object
+ * @tparam S - stage
+ */
+template<typename T, typename S>
+struct DynamicStageNode : DynamicStage<T>
+{
+    using Result = std::invoke_result_t<S&, T&>;
+    static_assert(std::is_void_v<Result> || std::is_same_v<Result, T&> || std::is_assignable_v<T&, Result>,
+                  "Stages of `dynamic_pipeline<T>` must return the context "
+                  "object, void or a value assignable to T");
+
+    template<typename Stage>
+    explicit DynamicStageNode(Stage&& value)
+        : DynamicStage<T>{&applyTo, &destroyIn}, stage(std::forward<Stage>(value)) {}
+
+    static void applyTo(DynamicStage<T>& node, T& contextObject)
+    {
+        S& stage = static_cast<DynamicStageNode&>(node).stage;
+        if constexpr (std::is_void_v<Result> || std::is_same_v<Result, T&>)
+            stage(contextObject);
+        else
+            contextObject = stage(contextObject);
+    }
+
+    static void destroyIn(DynamicStage<T>& node, std::pmr::memory_resource& resource) noexcept
+    {
+        auto& self = static_cast<DynamicStageNode&>(node);
+        self.~DynamicStageNode();
+        resource.deallocate(&self, sizeof(DynamicStageNode), alignof(DynamicStageNode));
+    }
+
+    S stage;
+};
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Pipeline of freestanding scope functions put together at runtime,
+ * for example from configuration. Every stage is applied to the context
+ * object in place: stages returning the context object, like `also`, or
+ * void, like a `run` without result, just run, and the results of other
+ * stages, like `let`, are assigned to the context object. A dynamic pipeline
+ * is a stage itself and can be placed on the right-hand side of operator|.
+ *
+ * The stages are type erased without std::function: each one is stored next
+ * to two function pointers in a single allocation from the memory resource
+ * given on construction, so with the default resource every push_back is an
+ * allocation of its own. With a std::pmr::monotonic_buffer_resource the
+ * stages are laid out contiguously, and there are no upstream allocations
+ * while they fit its initial buffer. The resource must outlive the pipeline.
+ *
+ * @example std::pmr::monotonic_buffer_resource arena(1024);
+ *          dynamic_pipeline<Image> filters(&arena);
+ *          for(const Filter& filter : config.filters) filters.push_back(also(makeFilter(filter)));
+ *          image | filters;
+ *
+ * @tparam T - type of context object
+ */
+template <typename T>
+struct dynamic_pipeline
+{
+    explicit dynamic_pipeline(std::pmr::memory_resource* memoryResource = std::pmr::get_default_resource()) noexcept
+        : resource(memoryResource) {}
+
+    dynamic_pipeline(dynamic_pipeline&& other) noexcept
+        : resource(other.resource), head(std::exchange(other.head, nullptr)),
+          tail(std::exchange(other.tail, nullptr)), stages(std::exchange(other.stages, 0)) {}
+
+    dynamic_pipeline& operator=(dynamic_pipeline&& other) noexcept
+    {
+        if(this != &other)
+        {
+            clear();
+            resource = other.resource;
+            head = std::exchange(other.head, nullptr);
+            tail = std::exchange(other.tail, nullptr);
+            stages = std::exchange(other.stages, 0);
+        }
+        return *this;
+    }
+
+    ~dynamic_pipeline() { clear(); }
+
+    /**
+     * @brief Appends stage, a freestanding scope function or a pipeline, which
+     * is moved or copied into the memory resource.
+     */
+    template<scopefn_internal::Stage S>
+    dynamic_pipeline& push_back(S&& stage)
+    {
+        using Node = scopefn_internal::DynamicStageNode<T, scopefn_internal::base_type<S>>;
+        void* memory = resource->allocate(sizeof(Node), alignof(Node));
+        Node* node;
+        try
+        {
+            node = ::new(memory) Node(std::forward<S>(stage));
+        }
+        catch(...)
+        {
+            resource->deallocate(memory, sizeof(Node), alignof(Node));
+            throw;
+        }
+        (tail ? tail->next : head) = node;
+        tail = node;
+        stages++;
+        return *this;
+    }
+
+    /**
+     * @brief Destroys all stages and returns their memory to the memory
+     * resource.
+     */
+    void clear() noexcept
+    {
+        while(head)
+        {
+            scopefn_internal::DynamicStage<T>* next = head->next;
+            head->destroy(*head, *resource);
+            head = next;
+        }
+        tail = nullptr;
+        stages = 0;
+    }
+
+    std::size_t size() const noexcept { return stages; }
+    bool empty() const noexcept { return stages == 0; }
+    std::pmr::memory_resource* memory_resource() const noexcept { return resource; }
+
+    /**
+     * @brief Applies the stages in order to the context object and returns a
+     * reference to it.
+     */
+    T& operator()(T& contextObject)
+    {
+        for(scopefn_internal::DynamicStage<T>* node = head; node; node = node->next)
+            node->apply(*node, contextObject);
+        return contextObject;
+    }
+
+    /**
+     * @brief Applies the stages in order to a temporary context object and
+     * returns it by value.
+     */
+    T operator()(T&& contextObject)
+    {
+        (*this)(static_cast<T&>(contextObject));
+        return std::move(contextObject);
+    }
+
+private:
+    std::pmr::memory_resource* resource;
+    scopefn_internal::DynamicStage<T>* head = nullptr;
+    scopefn_internal::DynamicStage<T>* tail = nullptr;
+    std::size_t stages = 0;
+};
+
+namespace scopefn_internal {
+
+template<typename T>
+struct IsStage<dynamic_pipeline<T>> : std::true_type {};
+
+template<typename T>
+struct PreservesContext<dynamic_pipeline<T>> : std::true_type {};
+
+template<typename T, typename Context>
+struct AcceptsContext<dynamic_pipeline<T>, Context> : std::is_same<base_type<Context>, T> {};
+
+} // namespace scopefn_internal
+
+} // namespace scopefn
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef _SCOPEFN_INPLACE_H
+#define _SCOPEFN_INPLACE_H
+
+#include "scopefn.hpp"
+#include <cstddef>
+#include <new>
+
+namespace scopefn {
+
+namespace scopefn_internal {
+
+/**
+ * @brief Operations on the callable stored in an inplace_function, other than
+ * calling it. One static table exists per callable type.
+ */
+struct InplaceOperations
+{
+    void (*copy)(void* destination, const void* source);
+    void (*move)(void* destination, void* source) noexcept;
+    void (*destroy)(void* callable) noexcept;
+};
+
+template<typename F>
+inline constexpr InplaceOperations inplaceOperations{
+    [](void* destination, const void* source) { ::new(destination) F(*static_cast<const F*>(source)); },
+    [](void* destination, void* source) noexcept { ::new(destination) F(std::move(*static_cast<F*>(source))); },
+    [](void* callable) noexcept { static_cast<F*>(callable)->~F(); }};
+
+} // namespace scopefn_internal
+
+template <typename Signature, std::size_t Capacity = 32>
+struct inplace_function;
+
+/**
+ * @brief Type erased callable like std::function, which stores the callable
+ * inline in a buffer of Capacity bytes and never allocates. Callables larger
+ * than the buffer are rejected at compile time. Its call operator has a
+ * single signature, so freestanding scope functions over an inplace_function
+ * have one type for all lambdas and can be stored in containers.
+ *
+ * Calling an empty inplace_function is undefined behaviour.
+ *
+ * @example std::vector<also<inplace_function<void(Request&)>>> handlers;
+ *          handlers.push_back(also<inplace_function<void(Request&)>>([](Request& it){ it.log(); }));
+ *
+ * @tparam R - return type
+ * @tparam Args - argument types
+ * @tparam Capacity - size of the inline buffer in bytes
+ */
+template <typename R, typename... Args, std::size_t Capacity>
+struct inplace_function<R(Args...), Capacity>
+{
+    constexpr inplace_function() noexcept = default;
+
+    template<typename F>
+        requires (!std::is_same_v<scopefn_internal::base_type<F>, inplace_function> &&
+                  std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    inplace_function(F&& callable) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>)
+    {
+        using Callable = std::decay_t<F>;
+        static_assert(sizeof(Callable) <= Capacity,
+                      "The lambda captures exceed the capacity of `inplace_function`, "
+                      "increase its Capacity argument");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t),
+                      "The lambda is over-aligned for `inplace_function`");
+        static_assert(std::is_copy_constructible_v<Callable> && std::is_nothrow_move_constructible_v<Callable>,
+                      "The lambda stored in `inplace_function` must be copyable and nothrow movable");
+        ::new(static_cast<void*>(storage)) Callable(std::forward<F>(callable));
+        call = [](void* stored, Args&&... args) -> R
+        {
+            // A void signature discards the result of the lambda, like std::function
+            if constexpr (std::is_void_v<R>)
+                scopefn_internal::invoke(*static_cast<Callable*>(stored), std::forward<Args>(args)...);
+            else
+                return scopefn_internal::invoke(*static_cast<Callable*>(stored), std::forward<Args>(args)...);
+        };
+        operations = &scopefn_internal::inplaceOperations<Callable>;
+    }
+
+    inplace_function(const inplace_function& other) : call(other.call), operations(other.operations)
+    {
+        if(operations)
+            operations->copy(storage, other.storage);
+    }
+
+    inplace_function(inplace_function&& other) noexcept : call(other.call), operations(other.operations)
+    {
+        if(operations)
+            operations->move(storage, other.storage);
+    }
+
+    inplace_function& operator=(const inplace_function& other)
+    {
+        if(this != &other)
+        {
+            reset();
+            if(other.operations)
+                other.operations->copy(storage, other.storage);
+            call = other.call;
+            operations = other.operations;
+        }
+        return *this;
+    }
+
+    inplace_function& operator=(inplace_function&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            if(other.operations)
+                other.operations->move(storage, other.storage);
+            call = other.call;
+            operations = other.operations;
+        }
+        return *this;
+    }
+
+    ~inplace_function() { reset(); }
+
+    explicit operator bool() const noexcept { return call != nullptr; }
+
+    /**
+     * @brief Calls the stored callable. Like std::function, the callable is
+     * called as non-const even through a const inplace_function.
+     */
+    R operator()(Args... args) const
+    {
+        return call(storage, std::forward<Args>(args)...);
+    }
+
+private:
+    void reset() noexcept
+    {
+        if(operations)
+            operations->destroy(storage);
+        call = nullptr;
+        operations = nullptr;
+    }
+
+    alignas(std::max_align_t) mutable std::byte storage[Capacity];
+    R (*call)(void*, Args&&...) = nullptr;
+    const scopefn_internal::InplaceOperations* operations = nullptr;
+};
+
+} // namespace scopefn
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef _SCOPEFN_LAZY_H
+#define _SCOPEFN_LAZY_H
+
+#include "scopefn.hpp"
+#include <atomic>
+#include <mutex>
+#include <optional>
+
+namespace scopefn {
+
+/**
+ * @brief Lazily initialized value, like a Kotlin `by lazy` property. The
+ * lambda accepts no arguments, like the one of `run`, and is invoked on the
+ * first access only. Initialization is thread-safe: concurrent first accesses
+ * wait for a single invocation of the lambda, later accesses only perform an
+ * atomic load. If the lambda throws, the exception is passed to the accessing
+ * thread and the next access tries again.
+ *
+ * Freestanding scope functions chained after a temporary lazy value are
+ * deferred as well and run after the lambda on first access. Chained after a
+ * named lazy value, they access it and run immediately.
+ *
+ * @example auto config = lazy([]{ return loadConfig(); }) | also(validate);
+ *
+ * @tparam L
+ */
+template <typename L>
+struct lazy
+{
+    using value_type = typename scopefn_internal::LambdaReflectionNoArg<L>::return_type;
+    static_assert(!std::is_void_v<value_type>, "The lambda of `lazy` must return the value");
+
+    constexpr lazy(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+
+    lazy(const lazy&) = delete;
+    lazy& operator=(const lazy&) = delete;
+
+    /**
+     * @brief Returns the value, invoking the lambda if this is the first
+     * access.
+     */
+    value_type& get()
+    {
+        if(!ready.load(std::memory_order_acquire))
+            initialize();
+        return *value;
+    }
+
+    const value_type& get() const
+    {
+        if(!ready.load(std::memory_order_acquire))
+            initialize();
+        return *value;
+    }
+
+    value_type& operator*() { return get(); }
+    const value_type& operator*() const { return get(); }
+    value_type* operator->() { return &get(); }
+    const value_type* operator->() const { return &get(); }
+
+    /**
+     * @brief Whether the lambda has already been invoked successfully. This
+     * doesn't access the value.
+     */
+    bool initialized() const noexcept { return ready.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Chaining operator deferring a freestanding scope function or a
+     * pipeline. Returns a lazy value invoking the lambda and applying stage to
+     * its result on first access. The lambda is moved out of value, which
+     * must not have been accessed yet.
+     */
+    template<scopefn_internal::Stage S>
+    friend auto operator|(lazy&& value, S&& stage)
+    {
+        using Stage = scopefn_internal::base_type<S>;
+        using Result = decltype(scopefn_internal::applyStage(std::declval<Stage&>(), std::declval<value_type>()));
+        return scopefn::lazy(
+            [fun = std::move(value.fun), stage = Stage(std::forward<S>(stage))]() mutable
+            -> scopefn_internal::base_type<Result>
+            {
+                return scopefn_internal::applyStage(stage, value_type(scopefn_internal::invoke(fun)));
+            });
+    }
+
+    /**
+     * @brief Chaining operator accessing a named lazy value and applying stage
+     * to it.
+     */
+    template<scopefn_internal::Stage S>
+    friend decltype(auto) operator|(lazy& value, S&& stage)
+    {
+        return value.get() | std::forward<S>(stage);
+    }
+
+    template<scopefn_internal::Stage S>
+    friend decltype(auto) operator|(const lazy& value, S&& stage)
+    {
+        return value.get() | std::forward<S>(stage);
+    }
+
+private:
+    void initialize() const
+    {
+        std::call_once(once, [this]
+        {
+            value.emplace(scopefn_internal::invoke(fun));
+            ready.store(true, std::memory_order_release);
+        });
+    }
+
+    mutable L fun;
+    mutable std::optional<value_type> value;
+    mutable std::once_flag once;
+    mutable std::atomic<bool> ready = false;
+};
+
+} // namespace scopefn
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _SCOPEFN_PARALLEL_H
+#define _SCOPEFN_PARALLEL_H
+
+// The parallel algorithm overloads must be declared before the range scope
+// functions calling them
+#include <execution>
+#include "scopefnranges.hpp"
+
+namespace scopefn {
+
+namespace scopefn_internal {
+
+/**
+ * @brief Accepts the standard execution policies, like std::execution::par,
+ * as the first argument of `also_each` and `let_each`. With libstdc++ the
+ * parallel algorithms run on TBB, so TUs including this header must link
+ * against it, for example with TBB::tbb in CMake.
+ *
+ * @tparam T
+ */
+#if __cpp_lib_parallel_algorithm
+template<typename T>
+    requires std::is_execution_policy_v<T>
+struct IsExecutionPolicy<T> : std::true_type {};
+#endif
+
+} // namespace scopefn_internal
+
+} // namespace scopefn
+
+#endif
@@ -0,0 +1,352 @@
+#ifndef _SCOPEFN_PROFILE_H
+#define _SCOPEFN_PROFILE_H
+
+#include "scopefn.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace scopefn {
+
+/**
+ * @brief Aggregated profiler for scope function call sites. The tracer
+ * records the number of calls, the total time and a latency histogram for
+ * every call site of a traced scope function, identified by the
+ * std::source_location of the call. Every thread records into its own table
+ * without locks, snapshot and dump merge the tables of all threads. When a
+ * thread exits its table is merged into a shared table of the exited threads
+ * and freed, so short-lived threads don't accumulate tables.
+ */
+namespace profile {
+
+/**
+ * @brief Number of latency histogram buckets. Bucket i counts the calls
+ * taking less than 4^(i+1) nanoseconds, the last bucket all longer ones.
+ */
+inline constexpr std::size_t histogram_size = 16;
+
+/**
+ * @brief Recorded statistics of a call site, merged over all threads.
+ */
+struct entry
+{
+    const char* function;
+    const char* file;
+    std::uint_least32_t line;
+    std::uint_least32_t column;
+    std::uint64_t calls;
+    std::uint64_t nanoseconds;
+    std::array<std::uint64_t, histogram_size> histogram;
+};
+
+} // namespace profile
+
+namespace scopefn_internal {
+
+/**
+ * @brief Statistics of a call site recorded by a single thread. Only the
+ * owning thread writes them, with relaxed atomic stores instead of
+ * read-modify-write operations, so other threads can read them concurrently.
+ * The call site is published with a release store of used after it is
+ * written.
+ */
+struct CallSiteStats
+{
+    void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> used = false;
+    const char* function = nullptr;
+    std::source_location location;
+    std::atomic<std::uint64_t> calls = 0;
+    std::atomic<std::uint64_t> nanoseconds = 0;
+    std::array<std::atomic<std::uint64_t>, profile::histogram_size> histogram{};
+};
+
+/**
+ * @brief Call site table of a thread, an open addressing hash table of fixed
+ * size so it never reallocates while being read. Calls of call sites that
+ * don't fit are counted as dropped.
+ */
+struct ThreadProfile
+{
+    static constexpr std::size_t capacity = 256;
+
+    CallSiteStats* find(const stage_info& stage) noexcept
+    {
+        const std::source_location& location = stage.location;
+        std::size_t hash = reinterpret_cast<std::uintptr_t>(location.file_name()) ^
+                           (std::size_t(location.line()) * 31 + location.column()) * 0x9e3779b97f4a7c15u;
+        for(std::size_t probe = 0; probe < capacity; probe++)
+        {
+            CallSiteStats& site = sites[(hash + probe) % capacity];
+            if(!site.used.load(std::memory_order_relaxed))
+            {
+                site.function = stage.function;
+                site.location = location;
+                site.used.store(true, std::memory_order_release);
+                return &site;
+            }
+            if(site.location.line() == location.line() && site.location.column() == location.column() &&
+               site.location.file_name() == location.file_name())
+                return &site;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Adds the statistics of other to this table. Calls of call sites
+     * which don't fit are counted as dropped.
+     */
+    void merge(const ThreadProfile& other) noexcept
+    {
+        for(const CallSiteStats& site : other.sites)
+        {
+            if(!site.used.load(std::memory_order_acquire))
+                continue;
+            CallSiteStats* into = find(stage_info{site.function, nullptr, site.location});
+            if(!into)
+            {
+                dropped.fetch_add(site.calls.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                continue;
+            }
+            into->add(into->calls, site.calls.load(std::memory_order_relaxed));
+            into->add(into->nanoseconds, site.nanoseconds.load(std::memory_order_relaxed));
+            for(std::size_t i = 0; i < profile::histogram_size; i++)
+                into->add(into->histogram[i], site.histogram[i].load(std::memory_order_relaxed));
+        }
+        dropped.fetch_add(other.dropped.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    std::array<CallSiteStats, capacity> sites;
+    std::atomic<std::uint64_t> dropped = 0;
+};
+
+/**
+ * @brief Owns the call site tables of the running threads which recorded a
+ * call, and the table of exited threads, which is one of them no thread
+ * records into. Only written with the mutex held.
+ */
+struct ProfileRegistry
+{
+    static ProfileRegistry& instance()
+    {
+        static ProfileRegistry registry;
+        return registry;
+    }
+
+    ThreadProfile* add()
+    {
+        std::lock_guard lock(mutex);
+        return threads.emplace_back(std::make_unique<ThreadProfile>()).get();
+    }
+
+    /**
+     * @brief Merges table into the table of exited threads and frees it.
+     */
+    void retire(ThreadProfile* table)
+    {
+        std::lock_guard lock(mutex);
+        if(!retired)
+            retired = threads.emplace_back(std::make_unique<ThreadProfile>()).get();
+        retired->merge(*table);
+        std::erase_if(threads, [table](const std::unique_ptr<ThreadProfile>& it) { return it.get() == table; });
+    }
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadProfile>> threads;
+    ThreadProfile* retired = nullptr;
+};
+
+/**
+ * @brief Thread local owner of the call site table of a thread, which retires
+ * the table when the thread exits.
+ */
+struct ThreadProfileOwner
+{
+    ThreadProfileOwner() : table(ProfileRegistry::instance().add()) {}
+    ThreadProfileOwner(const ThreadProfileOwner&) = delete;
+    ~ThreadProfileOwner() { ProfileRegistry::instance().retire(table); }
+
+    ThreadProfile* table;
+};
+
+/**
+ * @brief Returns the call site table of the calling thread, registering it on
+ * the first call.
+ */
+inline ThreadProfile& threadProfile()
+{
+    thread_local ThreadProfileOwner owner;
+    return *owner.table;
+}
+
+inline std::size_t histogramBucket(std::uint64_t nanoseconds) noexcept
+{
+    std::size_t bucket = 0;
+    while(nanoseconds >= 4 && bucket < profile::histogram_size - 1)
+    {
+        nanoseconds /= 4;
+        bucket++;
+    }
+    return bucket;
+}
+
+} // namespace scopefn_internal
+
+namespace profile {
+
+/**
+ * @brief Tracer recording every traced call into the table of the calling
+ * thread. Use it as the tracer policy of ScopeFunctions or with the traced
+ * freestanding scope functions.
+ *
+ * @example struct Order : ScopeFunctions<Order, profile::tracer> { ... };
+ * @example vec | let_traced(profile::tracer{}, [](std::vector<int>& it){ return it.size(); });
+ */
+struct tracer
+{
+    std::chrono::steady_clock::time_point begin(stage_info) const noexcept
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    void end(stage_info stage, std::chrono::steady_clock::time_point started) const noexcept
+    {
+        auto elapsed = std::chrono::steady_clock::now() - started;
+        auto nanoseconds = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+        scopefn_internal::ThreadProfile& thread = scopefn_internal::threadProfile();
+        scopefn_internal::CallSiteStats* site = thread.find(stage);
+        if(!site)
+        {
+            thread.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        site->add(site->calls, 1);
+        site->add(site->nanoseconds, nanoseconds);
+        site->add(site->histogram[scopefn_internal::histogramBucket(nanoseconds)], 1);
+    }
+};
+
+/**
+ * @brief Returns the statistics of all recorded call sites, merged over all
+ * threads and sorted by total time, the hottest first. Can be called while
+ * other threads are recording.
+ */
+inline std::vector<entry> snapshot()
+{
+    std::vector<entry> entries;
+    scopefn_internal::ProfileRegistry& registry = scopefn_internal::ProfileRegistry::instance();
+    std::lock_guard lock(registry.mutex);
+    for(const auto& thread : registry.threads)
+    {
+        for(const scopefn_internal::CallSiteStats& site : thread->sites)
+        {
+            if(!site.used.load(std::memory_order_acquire) || site.calls.load(std::memory_order_relaxed) == 0)
+                continue;
+            // The same call site has different file name pointers in different TUs
+            auto match = std::find_if(entries.begin(), entries.end(), [&site](const entry& it)
+            {
+                return it.line == site.location.line() && it.column == site.location.column() &&
+                       std::strcmp(it.file, site.location.file_name()) == 0;
+            });
+            if(match == entries.end())
+                match = entries.insert(entries.end(), entry{site.function, site.location.file_name(),
+                                                            site.location.line(), site.location.column(),
+                                                            0, 0, {}});
+            match->calls += site.calls.load(std::memory_order_relaxed);
+            match->nanoseconds += site.nanoseconds.load(std::memory_order_relaxed);
+            for(std::size_t i = 0; i < histogram_size; i++)
+                match->histogram[i] += site.histogram[i].load(std::memory_order_relaxed);
+        }
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const entry& a, const entry& b) { return a.nanoseconds > b.nanoseconds; });
+    return entries;
+}
+
+/**
+ * @brief Returns the number of calls which were not recorded because the
+ * table of their thread was full.
+ */
+inline std::uint64_t dropped()
+{
+    std::uint64_t total = 0;
+    scopefn_internal::ProfileRegistry& registry = scopefn_internal::ProfileRegistry::instance();
+    std::lock_guard lock(registry.mutex);
+    for(const auto& thread : registry.threads)
+        total += thread->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+/**
+ * @brief Writes the hottest call sites, at most limit of them, to out: the
+ * scope function, call site, number of calls, total and mean time and the
+ * latency histogram.
+ */
+inline void dump(std::ostream& out, std::size_t limit = 20)
+{
+    std::vector<entry> entries = snapshot();
+    out << "scopefn profile: " << entries.size() << " call sites\n";
+    for(std::size_t i = 0; i < std::min(limit, entries.size()); i++)
+    {
+        const entry& site = entries[i];
+        out << site.function << " at " << site.file << ':' << site.line << ':' << site.column
+            << "  calls " << site.calls << "  total " << site.nanoseconds << " ns  mean "
+            << (site.calls ? site.nanoseconds / site.calls : 0) << " ns  histogram";
+        std::size_t last = histogram_size;
+        while(last > 0 && site.histogram[last - 1] == 0)
+            last--;
+        for(std::size_t bucket = 0; bucket < last; bucket++)
+            out << ' ' << site.histogram[bucket];
+        out << '\n';
+    }
+    if(std::uint64_t lost = dropped())
+        out << lost << " calls not recorded, too many call sites\n";
+}
+
+/**
+ * @brief Writes the hottest call sites, at most limit of them, to std::cerr.
+ */
+inline void dump(std::size_t limit = 20)
+{
+    dump(std::cerr, limit);
+}
+
+/**
+ * @brief Clears the recorded statistics of all threads. Calls recorded
+ * concurrently may be partially lost.
+ */
+inline void reset()
+{
+    scopefn_internal::ProfileRegistry& registry = scopefn_internal::ProfileRegistry::instance();
+    std::lock_guard lock(registry.mutex);
+    for(const auto& thread : registry.threads)
+    {
+        for(scopefn_internal::CallSiteStats& site : thread->sites)
+        {
+            site.calls.store(0, std::memory_order_relaxed);
+            site.nanoseconds.store(0, std::memory_order_relaxed);
+            for(auto& bucket : site.histogram)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+        thread->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace profile
+
+} // namespace scopefn
+
+#endif
@@ -0,0 +1,603 @@
+#ifndef _SCOPEFN_RANGES_H
+#define _SCOPEFN_RANGES_H
+
+#include "scopefn.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <vector>
+
+namespace scopefn {
+
+namespace scopefn_internal {
+
+/**
+ * @brief Placeholder policy of the range scope functions when no execution
+ * policy is given. The elements are then visited by a plain loop, which can
+ * also be used in constant expressions.
+ */
+struct NoPolicy {};
+
+/**
+ * @brief Trait marking the execution policies accepted by the range scope
+ * functions. scopefnparallel.hpp specializes it for the standard execution
+ * policies, so <execution>, which libstdc++ implements on top of TBB, is
+ * only included by the TUs using them.
+ *
+ * @tparam T
+ */
+template<typename T>
+struct IsExecutionPolicy : std::false_type {};
+
+/**
+ * @brief Satisfied by NoPolicy and, with scopefnparallel.hpp, by the standard
+ * execution policies.
+ *
+ * @tparam T
+ */
+template<typename T>
+concept ExecutionPolicy =
+    std::is_same_v<base_type<T>, NoPolicy> || IsExecutionPolicy<base_type<T>>::value;
+
+/**
+ * @brief Satisfied by views computing their elements, like the ones produced
+ * by std::views::filter or std::views::transform. Range scope functions
+ * applied to such a view without an execution policy return a lazy view
+ * instead of visiting the elements immediately. Views referring to
+ * contiguous elements they don't own, like std::span or std::string_view,
+ * are visited eagerly like containers.
+ *
+ * @tparam T
+ */
+template<typename T>
+concept LazyView =
+    std::ranges::view<base_type<T>> &&
+    !(std::ranges::contiguous_range<base_type<T>> && std::ranges::sized_range<base_type<T>> &&
+      std::ranges::borrowed_range<base_type<T>>);
+
+/**
+ * @brief Lazy view returned by the range scope functions, which only call
+ * their lambda when the view is consumed, so discarding it is a mistake.
+ *
+ * @tparam V
+ */
+template<typename V>
+struct [[nodiscard]] LazyEachView : V
+{
+    constexpr explicit LazyEachView(V view) noexcept(std::is_nothrow_move_constructible_v<V>)
+        : V(std::move(view)) {}
+};
+
+/**
+ * @brief Helper alias for how the elements of a range of type R are passed to
+ * a range scope function. Elements of lvalue ranges and views are passed as
+ * the range yields them, elements of temporary containers as rvalues if the
+ * lambda accepts them.
+ *
+ * @tparam R - type of range, a reference type for lvalues
+ */
+template<typename R>
+using range_element =
+    std::conditional_t<std::is_lvalue_reference_v<R> || std::ranges::view<base_type<R>>,
+                       decltype(*std::begin(std::declval<R&>())),
+                       base_type<decltype(*std::begin(std::declval<R&>()))>>;
+
+/**
+ * @brief Satisfied by contiguous sized ranges of arithmetic elements, like
+ * std::vector<float> or std::array<int, N>. `let_each` transforms them by
+ * index into a presized result, a loop the compiler can auto-vectorize.
+ *
+ * @tparam R
+ */
+template<typename R>
+concept ContiguousArithmetic =
+    std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+    std::is_arithmetic_v<std::ranges::range_value_t<R>>;
+
+/**
+ * @brief Marks pointers which are the only way to access the memory they
+ * point to during a loop, so the compiler doesn't need to check for aliasing
+ * before vectorizing it.
+ */
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define SCOPEFN_RESTRICT __restrict
+#else
+#define SCOPEFN_RESTRICT
+#endif
+
+/**
+ * @brief Returns range itself if its begin and end iterators have the same
+ * type, as the standard parallel algorithms require, and otherwise a common
+ * view of it, like the ones of std::views::take over an unbounded range.
+ *
+ * @tparam R
+ */
+template<typename R>
+constexpr decltype(auto) commonRange(R& range)
+{
+    static_assert(std::ranges::forward_range<R>,
+                  "Range scope functions with an execution policy require a "
+                  "forward range, the elements are visited in parallel");
+    if constexpr (std::ranges::common_range<R>)
+        return (range);
+    else
+        return std::ranges::common_view(std::ranges::ref_view(range));
+}
+
+/**
+ * @brief Calls lambda for every element of range, as an lvalue, using the
+ * given execution policy.
+ *
+ * @tparam Policy
+ * @tparam L
+ * @tparam R
+ */
+template<typename Policy, typename L, typename R>
+constexpr void alsoEach(const Policy& policy, L& lambda, R& range)
+{
+    static_assert(ContextCallable<L, range_element<R&>>,
+                  "Scope function `also_each` argument type must match the "
+                  "element type of the context object");
+    if constexpr (std::is_same_v<Policy, NoPolicy>)
+    {
+        for(auto&& element : range)
+            scopefn_internal::invoke(lambda, element);
+    }
+    else
+    {
+        auto&& elements = commonRange(range);
+        std::for_each(policy, std::ranges::begin(elements), std::ranges::end(elements),
+                      [&lambda](auto&& element) { scopefn_internal::invoke(lambda, element); });
+    }
+}
+
+/**
+ * @brief Calls lambda for every element of range using the given execution
+ * policy and collects the results in a vector, in the order of the range.
+ *
+ * @tparam Policy
+ * @tparam L
+ * @tparam R - type of range, a reference type for lvalues
+ */
+template<typename Policy, typename L, typename R>
+constexpr auto letEach(const Policy& policy, L& lambda, R&& range)
+{
+    using Argument = context_argument<L, range_element<R>>;
+    static_assert(ContextCallable<L, range_element<R>>,
+                  "Scope function `let_each` argument type must match the "
+                  "element type of the context object");
+    using RT = base_type<std::invoke_result_t<L&, Argument>>;
+    static_assert(!std::is_void_v<RT>,
+                  "Scope function `let_each` lambda must return a value, "
+                  "use `also_each` for lambdas returning void");
+
+    std::vector<RT> result;
+    if constexpr (std::is_same_v<Policy, NoPolicy> && ContiguousArithmetic<R> && std::is_arithmetic_v<RT>)
+    {
+        // An indexed loop writing through a pointer into the fresh result
+        // vectorizes, unlike push_back, which checks the capacity every time
+        const std::size_t size = std::ranges::size(range);
+        result.resize(size);
+        auto* elements = std::ranges::data(range);
+        RT* SCOPEFN_RESTRICT output = result.data();
+        for(std::size_t i = 0; i < size; i++)
+            output[i] = scopefn_internal::invoke(lambda, static_cast<Argument>(elements[i]));
+    }
+    else if constexpr (std::is_same_v<Policy, NoPolicy>)
+    {
+        if constexpr (requires { std::size(range); })
+            result.reserve(std::size(range));
+        for(auto&& element : range)
+            result.push_back(scopefn_internal::invoke(lambda, static_cast<Argument>(element)));
+    }
+    else
+    {
+        static_assert(std::is_default_constructible_v<RT>,
+                      "Scope function `let_each` with an execution policy "
+                      "requires a default constructible lambda result");
+        auto&& elements = commonRange(range);
+        result.resize(std::ranges::distance(elements));
+        std::transform(policy, std::ranges::begin(elements), std::ranges::end(elements), result.begin(),
+                       [&lambda](auto&& element)
+                       { return scopefn_internal::invoke(lambda, static_cast<Argument>(element)); });
+    }
+    return result;
+}
+
+/**
+ * @brief Returns a lazy view calling lambda for every element of view as it
+ * is consumed, and yielding the element itself. The lambda is copied into the
+ * view, so the view doesn't refer to the scope function that created it.
+ *
+ * @tparam L
+ * @tparam V - type of view, a reference type for lvalues
+ */
+template<typename L, typename V>
+constexpr auto lazyAlsoEach(const L& lambda, V&& view)
+{
+    static_assert(ContextCallable<const L, range_element<V&>>,
+                  "Scope function `also_each` argument type must match the "
+                  "element type of the context object");
+    return LazyEachView(std::views::transform(
+        std::forward<V>(view),
+        [lambda](auto&& element) -> stage_result<decltype(element)&&>
+        {
+            scopefn_internal::invoke(lambda, element);
+            return std::forward<decltype(element)>(element);
+        }));
+}
+
+/**
+ * @brief Returns a lazy view of the results of calling lambda for every
+ * element of view, evaluated one element at a time as the view is consumed.
+ * The lambda is copied into the view, so the view doesn't refer to the scope
+ * function that created it.
+ *
+ * @tparam L
+ * @tparam V - type of view, a reference type for lvalues
+ */
+template<typename L, typename V>
+constexpr auto lazyLetEach(const L& lambda, V&& view)
+{
+    using Argument = context_argument<const L, range_element<V>>;
+    static_assert(ContextCallable<const L, range_element<V>>,
+                  "Scope function `let_each` argument type must match the "
+                  "element type of the context object");
+    using RT = base_type<std::invoke_result_t<const L&, Argument>>;
+    return LazyEachView(std::views::transform(
+        std::forward<V>(view),
+        [lambda](auto&& element) -> RT
+        { return scopefn_internal::invoke(lambda, static_cast<Argument>(element)); }));
+}
+
+/**
+ * @brief Batches of a range produced by `batch`, iterated as std::span<E> of
+ * batch size elements, the last one possibly shorter. The elements are either
+ * owned by the buffer, moved into it from a temporary range, or borrowed from
+ * an lvalue contiguous range without copying. Move only, so the spans keep
+ * pointing into the buffer.
+ *
+ * @tparam E - element type, const qualified for borrowed const ranges
+ */
+template<typename E>
+struct Batches
+{
+    /**
+     * @brief Forward iterator over the batches, a span of the elements not
+     * visited yet.
+     */
+    struct iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::span<E>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::span<E>;
+
+        std::span<E> operator*() const noexcept { return rest.first(std::min(size, rest.size())); }
+
+        iterator& operator++() noexcept
+        {
+            rest = rest.subspan(std::min(size, rest.size()));
+            return *this;
+        }
+
+        iterator operator++(int) noexcept
+        {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) noexcept
+        {
+            return a.rest.data() == b.rest.data() && a.rest.size() == b.rest.size();
+        }
+
+        std::span<E> rest;
+        std::size_t size = 1;
+    };
+
+    Batches(std::vector<std::remove_const_t<E>> elements, std::size_t batchSize) noexcept
+        : buffer(std::move(elements)), batch(batchSize ? batchSize : buffer.size())
+    {
+        view = buffer;
+    }
+
+    Batches(std::span<E> elements, std::size_t batchSize) noexcept
+        : view(elements), batch(batchSize ? batchSize : elements.size()) {}
+
+    Batches(Batches&&) noexcept = default;
+    Batches& operator=(Batches&&) noexcept = default;
+
+    iterator begin() const noexcept { return {view, std::max<std::size_t>(batch, 1)}; }
+    iterator end() const noexcept { return {view.subspan(view.size()), std::max<std::size_t>(batch, 1)}; }
+    std::size_t size() const noexcept { return batch ? (view.size() + batch - 1) / batch : 0; }
+    bool empty() const noexcept { return view.empty(); }
+
+    std::vector<std::remove_const_t<E>> buffer;
+    std::span<E> view;
+    std::size_t batch;
+};
+
+/**
+ * @brief Lazy view of the batches of view V produced by `batch`. Elements are
+ * pulled from the underlying view into a buffer as the batches are consumed,
+ * until the batch is full or, with a flush timeout, the timeout has passed
+ * since its first element arrived. The timeout is checked as elements arrive,
+ * it doesn't interrupt a view blocking on its next element. Each span is
+ * valid until the iterator is incremented, so the view is single-pass.
+ *
+ * @tparam V
+ */
+template<typename V>
+struct [[nodiscard]] BatchView : std::ranges::view_interface<BatchView<V>>
+{
+    using Element = std::ranges::range_value_t<V>;
+
+    struct iterator
+    {
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = std::span<Element>;
+        using difference_type = std::ptrdiff_t;
+
+        std::span<Element> operator*() const noexcept { return parent->buffer; }
+
+        iterator& operator++()
+        {
+            parent->fill();
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept
+        {
+            return it.parent->buffer.empty();
+        }
+
+        BatchView* parent;
+    };
+
+    BatchView(V view, std::size_t batchSize, std::chrono::steady_clock::duration timeout)
+        : base(std::move(view)), batch(batchSize), flushAfter(timeout) {}
+
+    iterator begin()
+    {
+        current = std::ranges::begin(base);
+        fill();
+        return {this};
+    }
+
+    std::default_sentinel_t end() const noexcept { return {}; }
+
+    void fill()
+    {
+        using Clock = std::chrono::steady_clock;
+        buffer.clear();
+        Clock::time_point first;
+        while((batch == 0 || buffer.size() < batch) && *current != std::ranges::end(base))
+        {
+            // Constructs from the element as the view yields it, so prvalues
+            // and rvalues are moved into the buffer
+            buffer.emplace_back(**current);
+            ++*current;
+            if(flushAfter == Clock::duration::zero())
+                continue;
+            if(buffer.size() == 1)
+                first = Clock::now();
+            else if(Clock::now() - first >= flushAfter)
+                break;
+        }
+    }
+
+    V base;
+    std::size_t batch;
+    std::chrono::steady_clock::duration flushAfter;
+    std::optional<std::ranges::iterator_t<V>> current;
+    std::vector<Element> buffer;
+};
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Freestanding also_each function. The `also_each` scope function
+ * accepts every element of the context object range as an argument and
+ * returns a reference to the same context object. With an execution policy
+ * the elements are visited with the standard parallel algorithms, so the
+ * lambda must be safe to call concurrently. Applied to a view computing its
+ * elements, like std::views::filter, without an execution policy,
+ * `also_each` returns a lazy view which calls the lambda for every element
+ * as it is consumed. A std::span or std::string_view is visited eagerly.
+ *
+ * @example vec | also_each([](int& it){ it *= 2; });
+ * @example vec | also_each(std::execution::par_unseq, [](int& it){ it *= 2; }); // scopefnparallel.hpp
+ *
+ * @tparam L
+ * @tparam Policy
+ */
+template <typename L, scopefn_internal::ExecutionPolicy Policy = scopefn_internal::NoPolicy>
+struct also_each
+{
+    constexpr also_each(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+    constexpr also_each(Policy executionPolicy, L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : policy(executionPolicy), fun(std::move(lambda)) {}
+
+    template<typename T>
+    constexpr decltype(auto) operator()(T&& contextObject)
+        noexcept(!lazy<T> && std::is_same_v<Policy, scopefn_internal::NoPolicy> &&
+                 std::is_nothrow_invocable_v<L&, scopefn_internal::range_element<T&>>)
+    {
+        if constexpr (lazy<T>)
+            return scopefn_internal::lazyAlsoEach(fun, std::forward<T>(contextObject));
+        else
+        {
+            scopefn_internal::alsoEach(policy, fun, contextObject);
+            return std::forward<T>(contextObject);
+        }
+    }
+
+    template<typename T>
+    constexpr decltype(auto) operator()(T&& contextObject) const
+        noexcept(!lazy<T> && std::is_same_v<Policy, scopefn_internal::NoPolicy> &&
+                 std::is_nothrow_invocable_v<const L&, scopefn_internal::range_element<T&>>)
+    {
+        if constexpr (lazy<T>)
+            return scopefn_internal::lazyAlsoEach(fun, std::forward<T>(contextObject));
+        else
+        {
+            scopefn_internal::alsoEach(policy, fun, contextObject);
+            return std::forward<T>(contextObject);
+        }
+    }
+
+    template<typename T>
+    static constexpr bool lazy =
+        std::is_same_v<Policy, scopefn_internal::NoPolicy> && scopefn_internal::LazyView<T>;
+
+    [[no_unique_address]] Policy policy;
+    L fun;
+};
+
+template<typename L>
+also_each(L) -> also_each<L>;
+
+template<scopefn_internal::ExecutionPolicy Policy, typename L>
+also_each(Policy, L) -> also_each<L, Policy>;
+
+/**
+ * @brief Freestanding let_each function. The `let_each` scope function
+ * accepts every element of the context object range as an argument and
+ * returns a std::vector of the lambda results. With an execution policy the
+ * elements are transformed with the standard parallel algorithms, so the
+ * lambda must be safe to call concurrently. Applied to a view computing its
+ * elements, like std::views::filter, without an execution policy,
+ * `let_each` returns a lazy view of the lambda results instead, so no
+ * intermediate container is allocated. A std::span or std::string_view is
+ * transformed eagerly into a std::vector.
+ *
+ * @example std::vector<int> sizes = names | let_each([](std::string& it){ return it.size(); });
+ *
+ * @tparam L
+ * @tparam Policy
+ */
+template <typename L, scopefn_internal::ExecutionPolicy Policy = scopefn_internal::NoPolicy>
+struct let_each
+{
+    constexpr let_each(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+    constexpr let_each(Policy executionPolicy, L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : policy(executionPolicy), fun(std::move(lambda)) {}
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject)
+    {
+        if constexpr (lazy<T>)
+            return scopefn_internal::lazyLetEach(fun, std::forward<T>(contextObject));
+        else
+            return scopefn_internal::letEach(policy, fun, std::forward<T>(contextObject));
+    }
+
+    template<typename T>
+    constexpr auto operator()(T&& contextObject) const
+    {
+        if constexpr (lazy<T>)
+            return scopefn_internal::lazyLetEach(fun, std::forward<T>(contextObject));
+        else
+            return scopefn_internal::letEach(policy, fun, std::forward<T>(contextObject));
+    }
+
+    template<typename T>
+    static constexpr bool lazy =
+        std::is_same_v<Policy, scopefn_internal::NoPolicy> && scopefn_internal::LazyView<T>;
+
+    [[no_unique_address]] Policy policy;
+    L fun;
+};
+
+template<typename L>
+let_each(L) -> let_each<L>;
+
+template<scopefn_internal::ExecutionPolicy Policy, typename L>
+let_each(Policy, L) -> let_each<L, Policy>;
+
+/**
+ * @brief Freestanding batch function. The `batch` scope function groups the
+ * elements of the context object range into consecutive std::span batches of
+ * size elements, so the following `let_each` or `also_each` runs once per
+ * batch instead of once per element. A size of 0 puts all elements into a
+ * single batch.
+ *
+ * Temporary ranges are moved into the batch buffer, a temporary std::vector
+ * is taken over as a whole, and lvalue contiguous ranges and spans, like the
+ * chunks of a stream, are batched in place without copying. Applied to a view
+ * computing its elements, `batch` returns a lazy view which pulls elements into the buffer as the
+ * batches are consumed, and with a flush timeout emits a shorter batch once
+ * the timeout has passed since its first element.
+ *
+ * @example std::move(rows) | batch(256) | also_each([&db](std::span<Row> it){ db.insert(it); });
+ * @example messages | batch(64, 10ms) | also_each(send);
+ */
+struct batch
+{
+    constexpr explicit batch(std::size_t batchSize,
+                             std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::zero()) noexcept
+        : size(batchSize), flushAfter(timeout) {}
+
+    template<std::ranges::input_range T>
+    auto operator()(T&& contextObject) const
+    {
+        using Element = std::ranges::range_value_t<T>;
+        if constexpr (scopefn_internal::LazyView<T>)
+            return scopefn_internal::BatchView<std::views::all_t<T>>(
+                std::views::all(std::forward<T>(contextObject)), size, flushAfter);
+        else if constexpr ((std::is_lvalue_reference_v<T> || std::ranges::borrowed_range<T>) &&
+                           std::ranges::contiguous_range<T> && std::ranges::sized_range<T>)
+        {
+            using Borrowed = std::remove_reference_t<std::ranges::range_reference_t<T>>;
+            return scopefn_internal::Batches<Borrowed>(
+                std::span<Borrowed>(std::ranges::data(contextObject), std::ranges::size(contextObject)), size);
+        }
+        else if constexpr (std::is_same_v<scopefn_internal::base_type<T>, std::vector<Element>> &&
+                           !std::is_lvalue_reference_v<T>)
+            return scopefn_internal::Batches<Element>(std::move(contextObject), size);
+        else
+        {
+            std::vector<Element> buffer;
+            if constexpr (std::ranges::sized_range<T>)
+                buffer.reserve(std::ranges::size(contextObject));
+            for(auto&& element : contextObject)
+            {
+                if constexpr (std::is_lvalue_reference_v<T>)
+                    buffer.push_back(element);
+                else
+                    buffer.push_back(std::move(element));
+            }
+            return scopefn_internal::Batches<Element>(std::move(buffer), size);
+        }
+    }
+
+    std::size_t size;
+    std::chrono::steady_clock::duration flushAfter;
+};
+
+namespace scopefn_internal {
+
+template<typename L, typename Policy>
+struct IsStage<also_each<L, Policy>> : std::true_type {};
+
+template<typename L, typename Policy>
+struct IsStage<let_each<L, Policy>> : std::true_type {};
+
+template<>
+struct IsStage<batch> : std::true_type {};
+
+} // namespace scopefn_internal
+
+} // namespace scopefn
+
+#endif
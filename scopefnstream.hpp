@@ -0,0 +1,217 @@
+#ifndef _SCOPEFN_STREAM_H
+#define _SCOPEFN_STREAM_H
+
+#include "scopefn.hpp"
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <semaphore>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace scopefn {
+
+namespace scopefn_internal {
+
+/**
+ * @brief Placeholder stage of a stream without stages, which are added with
+ * operator|.
+ */
+struct NoStages {};
+
+template<typename T>
+struct SpanElement {};
+
+template<typename T>
+struct SpanElement<std::span<T>>
+{
+    using type = T;
+};
+
+/**
+ * @brief Chunk element type of a reader accepting a std::span<T>, void when
+ * it can't be deduced.
+ *
+ * @tparam Reader
+ */
+template<typename Reader>
+struct ReaderElement
+{
+    using type = void;
+};
+
+template<typename Reader>
+    requires CallableSignature<Reader>::deducible &&
+             requires { typename SpanElement<base_type<typename CallableSignature<Reader>::argument_type>>::type; }
+struct ReaderElement<Reader>
+{
+    using type = typename SpanElement<base_type<typename CallableSignature<Reader>::argument_type>>::type;
+};
+
+/**
+ * @brief Chunk buffer of a stream and the synchronization handing it from the
+ * reader thread to the processing thread and back.
+ *
+ * @tparam T - element type
+ */
+template<typename T>
+struct ChunkSlot
+{
+    std::vector<T> buffer;
+    // Released once more when the stages throw, to wake the reader up
+    std::counting_semaphore<2> free{1};
+    std::binary_semaphore filled{0};
+};
+
+/**
+ * @brief Reads chunks of chunkSize elements with reader and applies stages to
+ * every chunk, until the reader returns 0. Reading runs on a separate thread
+ * into two alternating buffers, so the next chunk is read while the current
+ * one is processed. Exceptions of the reader or the stages stop the stream
+ * and are rethrown on the calling thread.
+ *
+ * @return the number of processed chunks
+ */
+template<typename T, typename Reader, typename S>
+std::size_t streamChunks(Reader& reader, std::size_t chunkSize, S& stages)
+{
+    ChunkSlot<T> slots[2];
+    std::atomic<bool> stopped = false;
+    std::exception_ptr readError;
+
+    std::thread readerThread([&]
+    {
+        for(std::size_t chunk = 0;; chunk++)
+        {
+            ChunkSlot<T>& slot = slots[chunk % 2];
+            slot.free.acquire();
+            if(stopped.load(std::memory_order_relaxed))
+                return;
+            try
+            {
+                slot.buffer.resize(chunkSize);
+                std::size_t read = scopefn_internal::invoke(reader, std::span<T>(slot.buffer));
+                slot.buffer.resize(read < chunkSize ? read : chunkSize);
+            }
+            catch(...)
+            {
+                readError = std::current_exception();
+                slot.buffer.clear();
+            }
+            bool last = slot.buffer.empty();
+            slot.filled.release();
+            if(last)
+                return;
+        }
+    });
+
+    std::size_t chunks = 0;
+    try
+    {
+        for(;; chunks++)
+        {
+            ChunkSlot<T>& slot = slots[chunks % 2];
+            slot.filled.acquire();
+            if(slot.buffer.empty())
+                break;
+            scopefn_internal::applyStage(stages, slot.buffer);
+            slot.free.release();
+        }
+    }
+    catch(...)
+    {
+        stopped.store(true, std::memory_order_relaxed);
+        slots[0].free.release();
+        slots[1].free.release();
+        readerThread.join();
+        throw;
+    }
+    readerThread.join();
+    if(readError)
+        std::rethrow_exception(readError);
+    return chunks;
+}
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Stream of chunks read from a source larger than memory, like a file
+ * or a socket. Freestanding scope functions chained after it with operator|
+ * are applied to every chunk, a std::vector<T>& holding the elements read, as
+ * their context object. Nothing is read until run is called, which pushes the
+ * chunks through the stages. At most two chunks are held in memory: the next
+ * one is read on a separate thread while the current one is processed.
+ *
+ * @example (stream<char>(reader, 1 << 20) | let_each(parse) | also(write)).run();
+ *
+ * @tparam T - element type
+ * @tparam Reader - callable filling a std::span<T> and returning the number
+ *                  of elements read, 0 at the end of the stream
+ * @tparam S - stages applied to every chunk
+ */
+template <typename T, typename Reader, typename S = scopefn_internal::NoStages>
+struct chunk_stream
+{
+    /**
+     * @brief Reads the whole stream and applies the stages to every chunk.
+     *
+     * @return the number of processed chunks
+     */
+    std::size_t run()
+    {
+        if constexpr (std::is_same_v<S, scopefn_internal::NoStages>)
+        {
+            auto discard = also([](std::vector<T>&) {});
+            return scopefn_internal::streamChunks<T>(reader, chunkSize, discard);
+        }
+        else
+            return scopefn_internal::streamChunks<T>(reader, chunkSize, stages);
+    }
+
+    /**
+     * @brief Chaining operator adding a freestanding scope function or a
+     * pipeline to the stages applied to every chunk.
+     */
+    template<scopefn_internal::Stage Next>
+    friend auto operator|(chunk_stream&& source, Next&& next)
+    {
+        if constexpr (std::is_same_v<S, scopefn_internal::NoStages>)
+            return chunk_stream<T, Reader, scopefn_internal::base_type<Next>>{
+                std::move(source.reader), source.chunkSize, std::forward<Next>(next)};
+        else
+            return chunk_stream<T, Reader, pipeline<S, scopefn_internal::base_type<Next>>>{
+                std::move(source.reader), source.chunkSize, {std::move(source.stages), std::forward<Next>(next)}};
+    }
+
+    Reader reader;
+    std::size_t chunkSize;
+    [[no_unique_address]] S stages;
+};
+
+/**
+ * @brief Creates a chunk_stream reading chunks of chunkSize elements with
+ * reader. The element type is deduced from the std::span<T> argument of the
+ * reader, or can be given explicitly.
+ *
+ * @example auto lines = stream([&file](std::span<char> it){ return file.readsome(it.data(), it.size()); }, 4096);
+ *
+ * @tparam T - element type
+ * @tparam Reader
+ */
+template<typename T = void, typename Reader>
+auto stream(Reader reader, std::size_t chunkSize)
+{
+    using Element = std::conditional_t<std::is_void_v<T>, typename scopefn_internal::ReaderElement<Reader>::type, T>;
+    static_assert(!std::is_void_v<Element>,
+                  "The element type of `stream` can't be deduced from the reader, "
+                  "pass it explicitly as in stream<char>(reader, chunkSize)");
+    static_assert(std::is_invocable_r_v<std::size_t, Reader&, std::span<Element>>,
+                  "The reader of `stream` must accept a std::span of the elements "
+                  "and return the number of elements read");
+    return chunk_stream<Element, Reader>{std::move(reader), chunkSize, {}};
+}
+
+} // namespace scopefn
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef _SCOPEFN_TUPLE_H
+#define _SCOPEFN_TUPLE_H
+
+#include "scopefn.hpp"
+#include <tuple>
+
+namespace scopefn {
+
+namespace scopefn_internal {
+
+/**
+ * @brief Satisfied by tuple-like types, like std::tuple, std::pair and
+ * std::array, whose elements can be unpacked with std::apply.
+ *
+ * @tparam T
+ */
+template<typename T>
+concept TupleLike = requires { std::tuple_size<base_type<T>>::value; };
+
+/**
+ * @brief Checks that calling lambda L with every element of a tuple of type
+ * Tuple, as an lvalue, cannot throw.
+ *
+ * @tparam L
+ * @tparam Tuple - tuple type, const qualified for const tuples
+ */
+template<typename L, typename Tuple, std::size_t... I>
+constexpr bool nothrowForAll(std::index_sequence<I...>)
+{
+    return (std::is_nothrow_invocable_v<L&, decltype(std::get<I>(std::declval<Tuple&>()))> && ...);
+}
+
+/**
+ * @brief Calls lambda for every element of tuple, as an lvalue. The calls are
+ * unrolled by a fold expression, so they are made in the order of the
+ * elements without a loop.
+ *
+ * @tparam L
+ * @tparam Tuple - tuple type, const qualified for const tuples
+ */
+template<typename L, typename Tuple>
+constexpr void alsoAll(L& lambda, Tuple& tuple)
+    noexcept(nothrowForAll<L, Tuple>(std::make_index_sequence<std::tuple_size_v<base_type<Tuple>>>()))
+{
+    std::apply([&lambda](auto&... elements)
+    {
+        static_assert((ContextCallable<L, decltype(elements)> && ...),
+                      "Scope function `also_all` argument type must match "
+                      "every element type of the context object");
+        (scopefn_internal::invoke(lambda, elements), ...);
+    }, tuple);
+}
+
+/**
+ * @brief Calls lambda for every element of tuple and returns a std::tuple of
+ * the results, in the order of the elements. Elements of temporary tuples are
+ * passed as rvalues if the lambda accepts them.
+ *
+ * @tparam L
+ * @tparam Tuple - tuple type, a reference type for lvalues
+ */
+template<typename L, typename Tuple>
+constexpr auto letAll(L& lambda, Tuple&& tuple)
+{
+    return std::apply([&lambda](auto&&... elements)
+    {
+        static_assert((ContextCallable<L, decltype(elements)> && ...),
+                      "Scope function `let_all` argument type must match "
+                      "every element type of the context object");
+        static_assert(!(std::is_void_v<std::invoke_result_t<L&, context_argument<L, decltype(elements)>>> || ...),
+                      "Scope function `let_all` lambda must return a value, "
+                      "use `also_all` for lambdas returning void");
+        // Braced initialization evaluates the calls in the order of the elements
+        return std::tuple<base_type<std::invoke_result_t<L&, context_argument<L, decltype(elements)>>>...>{
+            scopefn_internal::invoke(lambda, static_cast<context_argument<L, decltype(elements)>>(elements))...};
+    }, std::forward<Tuple>(tuple));
+}
+
+} // namespace scopefn_internal
+
+/**
+ * @brief Freestanding also_all function. The `also_all` scope function
+ * accepts every element of the context object tuple as an argument and
+ * returns a reference to the same context object, like `also` applied to
+ * each element. The elements may have different types, so the lambda is
+ * usually generic. The calls are unrolled at compile time and inline into a
+ * single block.
+ *
+ * @example std::tie(engine, wheels, doors) | also_all([](auto& it){ it.reset(); });
+ *
+ * @tparam L
+ */
+template <typename L>
+struct also_all
+{
+    constexpr also_all(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+
+    template<scopefn_internal::TupleLike T>
+    constexpr scopefn_internal::stage_result<T&&> operator()(T&& contextObject)
+        noexcept(noexcept(scopefn_internal::alsoAll(fun, contextObject)) &&
+                 std::is_nothrow_constructible_v<scopefn_internal::stage_result<T&&>, T>)
+    {
+        scopefn_internal::alsoAll(fun, contextObject);
+        return std::forward<T>(contextObject);
+    }
+
+    template<scopefn_internal::TupleLike T>
+    constexpr scopefn_internal::stage_result<T&&> operator()(T&& contextObject) const
+        noexcept(noexcept(scopefn_internal::alsoAll(fun, contextObject)) &&
+                 std::is_nothrow_constructible_v<scopefn_internal::stage_result<T&&>, T>)
+    {
+        scopefn_internal::alsoAll(fun, contextObject);
+        return std::forward<T>(contextObject);
+    }
+
+    L fun;
+};
+
+/**
+ * @brief Freestanding let_all function. The `let_all` scope function accepts
+ * every element of the context object tuple as an argument and returns a
+ * std::tuple of the lambda results, like `let` applied to each element. The
+ * calls are unrolled at compile time.
+ *
+ * @example auto [w, h] = std::tie(window, header) | let_all([](auto& it){ return it.height(); });
+ *
+ * @tparam L
+ */
+template <typename L>
+struct let_all
+{
+    constexpr let_all(L lambda) noexcept(std::is_nothrow_move_constructible_v<L>)
+        : fun(std::move(lambda)) {}
+
+    template<scopefn_internal::TupleLike T>
+    constexpr auto operator()(T&& contextObject)
+    {
+        return scopefn_internal::letAll(fun, std::forward<T>(contextObject));
+    }
+
+    template<scopefn_internal::TupleLike T>
+    constexpr auto operator()(T&& contextObject) const
+    {
+        return scopefn_internal::letAll(fun, std::forward<T>(contextObject));
+    }
+
+    L fun;
+};
+
+namespace scopefn_internal {
+
+template<typename L>
+struct IsStage<also_all<L>> : std::true_type {};
+
+template<typename L>
+struct IsStage<let_all<L>> : std::true_type {};
+
+template<typename L>
+struct PreservesContext<also_all<L>> : std::true_type {};
+
+} // namespace scopefn_internal
+
+} // namespace scopefn
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _ALLOCATIONCOUNTER_H
+#define _ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+/**
+ * @brief Test harness counting heap allocations. The global operator new is
+ * replaced in allocationcounter.cpp to count every allocation of the calling
+ * thread, so tests can assert that scope function chains never allocate.
+ */
+namespace allocationcounter {
+
+/**
+ * @brief Returns the number of operator new calls made by the calling thread
+ * since it started.
+ */
+std::size_t allocations() noexcept;
+
+/**
+ * @brief Runs func and returns the number of heap allocations it made on the
+ * calling thread.
+ *
+ * @tparam F
+ * @param func
+ * @return std::size_t
+ */
+template<typename F>
+std::size_t countAllocations(F&& func)
+{
+    std::size_t before = allocations();
+    func();
+    return allocations() - before;
+}
+
+} // namespace allocationcounter
+
+#endif
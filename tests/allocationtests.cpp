@@ -0,0 +1,143 @@
+#include "allocationcounter.hpp"
+#include "testentities.hpp"
+#include <algorithm>
+#include <array>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <scopefnmacros.hpp>
+
+using namespace scopefn;
+using allocationcounter::countAllocations;
+
+TEST(AllocationTests, CounterTest)
+{
+    // The allocations escape, so the compiler can't elide them
+    std::unique_ptr<int> single;
+    std::unique_ptr<int[]> array;
+    std::string text;
+    ASSERT_EQ(countAllocations([&] { single = std::make_unique<int>(1); }), 1);
+    ASSERT_EQ(countAllocations([&] { array = std::make_unique<int[]>(4); }), 1);
+    ASSERT_EQ(countAllocations([&] { text = std::string(100, 'x'); }), 1);
+    ASSERT_EQ(countAllocations([] {}), 0);
+}
+
+TEST(AllocationTests, MixingFunctionsTest)
+{
+    std::vector<int> vec{1, 2, 3};
+    vec.reserve(4);
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    unsigned num = 0;
+
+    size_t allocations = countAllocations([&]
+    {
+        num = vec
+            | also([](std::vector<int>& it) { it.push_back(4); })
+            | let([](std::vector<int>& it) -> unsigned { return *std::max_element(it.begin(), it.end()); })
+            | also([](unsigned& it) { it = it * 2; });
+
+        person.apply([self = &person, num] { self->age = num; })
+              .apply([self = &person] { self->name.clear(); })
+              .also([](Person& it) { it.location.clear(); })
+              .let([](Person& it) { return it.age; });
+    });
+
+    ASSERT_EQ(allocations, 0);
+    ASSERT_EQ(num, 8);
+    ASSERT_EQ(person.age, 8);
+}
+
+TEST(AllocationTests, CrazyMacrosTest)
+{
+    std::vector<int> vec{1, 2, 3};
+    vec.reserve(4);
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    int num = 0;
+
+    size_t allocations = countAllocations([&]
+    {
+        num = vec
+            | ALSO(vec, { it.push_back(4); })
+            | LET(vec, { return *std::max_element(it.begin(), it.end()); })
+            | ALSO(int(), { it = it * 2; });
+
+        person.APPLY(person, { self->age = 8; })
+              .APPLY(person, { self->name.clear(); })
+              .ALSO(person, { it.location.clear(); });
+    });
+
+    ASSERT_EQ(allocations, 0);
+    ASSERT_EQ(num, 8);
+}
+
+TEST(AllocationTests, LargeCaptureTest)
+{
+    // Captures far beyond any std::function small buffer are stored inline
+    std::array<int, 256> weights{};
+    weights.fill(2);
+    int total = 0;
+
+    size_t allocations = countAllocations([&]
+    {
+        auto sum = [weights](int& it) { for(int w : weights) it += w; };
+        auto stages = also(sum) | also(sum) | let([weights](int& it) { return it + weights[0]; });
+        total = 0 | stages;
+        total += Point{}.also([weights](Point& it) { it.x = weights[1]; })
+                        .let([](Point&& it) { return it.x; });
+        total += 1 | let_traced(NoTracer{}, [weights](int& it) { return it * weights[2]; });
+    });
+
+    ASSERT_EQ(allocations, 0);
+    ASSERT_EQ(total, 1024 + 2 + 2 + 2);
+}
+
+/**
+ * @brief Stateful tracer counting the traced calls and the nesting depth,
+ * without allocating itself.
+ */
+struct CountingTracer
+{
+    static inline unsigned policyCalls = 0;
+
+    unsigned begin(stage_info)
+    {
+        calls++;
+        policyCalls++;
+        return depth++;
+    }
+    void end(stage_info, unsigned started) { depth = started; }
+
+    unsigned calls = 0;
+    unsigned depth = 0;
+};
+
+struct CountedPoint : ScopeFunctions<CountedPoint, CountingTracer>
+{
+    int x = 0;
+};
+
+TEST(AllocationTests, TracedStagesTest)
+{
+    // Real tracing, unlike NoTracer, which compiles the tracing away
+    std::array<int, 256> weights{};
+    weights.fill(2);
+    CountingTracer tracer;
+    CountedPoint point;
+    CountingTracer::policyCalls = 0;
+    int total = 0;
+
+    size_t allocations = countAllocations([&]
+    {
+        auto stages = also_traced(tracer, [weights](int& it) { it += weights[0]; })
+                    | let_traced(tracer, [weights](int& it) { return it * weights[1]; });
+        total = 1 | stages;
+        total += 1 | let_traced(CountingTracer{}, [weights](int& it) { return it + weights[2]; });
+        total += point.also([weights](CountedPoint& it) { it.x = weights[3]; })
+                      .let([](CountedPoint& it) { return it.x; });
+    });
+
+    ASSERT_EQ(allocations, 0);
+    ASSERT_EQ(total, 6 + 3 + 2);
+    ASSERT_EQ(tracer.calls, 2);
+    ASSERT_EQ(CountingTracer::policyCalls, 5);
+}
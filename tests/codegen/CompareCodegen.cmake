@@ -0,0 +1,47 @@
+# Compiles a codegen snippet twice, once as hand-written code and once through
+# the scope functions, and compares the generated assembly. The check fails if
+# the scope function variant emits more instructions or calls than the
+# hand-written variant, or references allocation, vtable or std::function
+# symbols that the hand-written variant doesn't.
+#
+# Expected variables: COMPILER, SOURCE, INCLUDE_DIR, OPT, OUTPUT_DIR
+
+set(FORBIDDEN_SYMBOLS "_Znwm|_Znam|_Znwj|_Znaj|_ZTV|_Function_handler|_Function_base|__cxa_pure_virtual")
+
+get_filename_component(SNIPPET ${SOURCE} NAME_WE)
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+foreach(VARIANT 0 1)
+    set(ASM ${OUTPUT_DIR}/${SNIPPET}${OPT}.${VARIANT}.s)
+    execute_process(
+        COMMAND ${COMPILER} -std=c++20 ${OPT} -S -fno-asynchronous-unwind-tables
+                -DSCOPEFN_CODEGEN_VARIANT=${VARIANT} -I${INCLUDE_DIR} ${SOURCE} -o ${ASM}
+        RESULT_VARIABLE RESULT
+        ERROR_VARIABLE ERRORS)
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Compiling ${SNIPPET} variant ${VARIANT} failed:\n${ERRORS}")
+    endif()
+
+    file(STRINGS ${ASM} INSTRUCTIONS REGEX "^\t[a-z]")
+    file(STRINGS ${ASM} CALLS REGEX "^\t(call|bl|blr)[ \t]")
+    file(STRINGS ${ASM} FORBIDDEN REGEX "${FORBIDDEN_SYMBOLS}")
+    list(LENGTH INSTRUCTIONS INSTRUCTIONS_${VARIANT})
+    list(LENGTH CALLS CALLS_${VARIANT})
+    list(LENGTH FORBIDDEN FORBIDDEN_${VARIANT})
+endforeach()
+
+message(STATUS "${SNIPPET} ${OPT}: hand-written ${INSTRUCTIONS_0} instructions, ${CALLS_0} calls; "
+               "scopefn ${INSTRUCTIONS_1} instructions, ${CALLS_1} calls")
+
+if(FORBIDDEN_1 GREATER FORBIDDEN_0)
+    message(FATAL_ERROR "${SNIPPET} ${OPT}: scopefn variant references allocation, vtable or "
+                        "std::function symbols not present in the hand-written variant")
+endif()
+if(CALLS_1 GREATER CALLS_0)
+    message(FATAL_ERROR "${SNIPPET} ${OPT}: scopefn variant emits ${CALLS_1} calls, "
+                        "hand-written variant ${CALLS_0}")
+endif()
+if(INSTRUCTIONS_1 GREATER INSTRUCTIONS_0)
+    message(FATAL_ERROR "${SNIPPET} ${OPT}: scopefn variant emits ${INSTRUCTIONS_1} instructions, "
+                        "hand-written variant ${INSTRUCTIONS_0}")
+endif()
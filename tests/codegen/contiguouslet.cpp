@@ -0,0 +1,42 @@
+#include "scopefnranges.hpp"
+#include <span>
+
+using namespace scopefn;
+
+// let_each over a contiguous arithmetic range, a container or a span, must
+// compile to the same vectorizable loop as transforming into a presized
+// vector by hand.
+
+#if SCOPEFN_CODEGEN_VARIANT
+std::vector<float> scale(std::vector<float>& samples, float gain)
+{
+    return samples | let_each([gain](float& it) { return it * gain; });
+}
+
+std::vector<int> offset(std::span<const int> values, int delta)
+{
+    return values | let_each([delta](int it) { return it + delta; });
+}
+#else
+std::vector<float> scale(std::vector<float>& samples, float gain)
+{
+    std::vector<float> result;
+    result.resize(samples.size());
+    const float* input = samples.data();
+    float* output = result.data();
+    for(std::size_t i = 0; i < samples.size(); i++)
+        output[i] = input[i] * gain;
+    return result;
+}
+
+std::vector<int> offset(std::span<const int> values, int delta)
+{
+    std::vector<int> result;
+    result.resize(values.size());
+    const int* input = values.data();
+    int* output = result.data();
+    for(std::size_t i = 0; i < values.size(); i++)
+        output[i] = input[i] + delta;
+    return result;
+}
+#endif
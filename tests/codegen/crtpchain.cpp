@@ -0,0 +1,23 @@
+#include "scopefn.hpp"
+
+struct Counter : scopefn::ScopeFunctions<Counter>
+{
+    int value;
+    int hits;
+};
+
+#if SCOPEFN_CODEGEN_VARIANT
+int touch(Counter& counter)
+{
+    return counter.apply([self = &counter] { self->hits++; })
+                  .also([](Counter& it) { it.value *= 3; })
+                  .let([](Counter& it) { return it.value + it.hits; });
+}
+#else
+int touch(Counter& counter)
+{
+    counter.hits++;
+    counter.value *= 3;
+    return counter.value + counter.hits;
+}
+#endif
@@ -0,0 +1,26 @@
+#include "scopefn.hpp"
+
+using namespace scopefn;
+
+struct Counter : ScopeFunctions<Counter, NoTracer>
+{
+    int value = 0;
+};
+
+#if SCOPEFN_CODEGEN_VARIANT
+int count(Counter& counter, int& total)
+{
+    total | also_traced(NoTracer{}, [](int& it) { it += 2; });
+    return counter.also([](Counter& it) { it.value++; })
+                  .apply([&total] { total++; })
+                  .let([](Counter& it) { return it.value * 2; });
+}
+#else
+int count(Counter& counter, int& total)
+{
+    total += 2;
+    counter.value++;
+    total++;
+    return counter.value * 2;
+}
+#endif
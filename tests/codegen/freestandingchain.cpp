@@ -0,0 +1,21 @@
+#include "scopefn.hpp"
+#include <cstddef>
+#include <vector>
+
+using namespace scopefn;
+
+#if SCOPEFN_CODEGEN_VARIANT
+size_t grow(std::vector<int>& vec)
+{
+    return vec | also([](std::vector<int>& it) { it.push_back(1); })
+               | also([](std::vector<int>& it) { it.back() *= 2; })
+               | let([](std::vector<int>& it) { return it.size(); });
+}
+#else
+size_t grow(std::vector<int>& vec)
+{
+    vec.push_back(1);
+    vec.back() *= 2;
+    return vec.size();
+}
+#endif
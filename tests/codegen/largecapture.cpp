@@ -0,0 +1,32 @@
+#include "scopefn.hpp"
+#include <array>
+
+using namespace scopefn;
+
+// A capture larger than the std::function small buffer must not allocate and
+// must cost the same as calling the lambda directly.
+
+#if SCOPEFN_CODEGEN_VARIANT
+int weigh(int value, const std::array<int, 16>& weights)
+{
+    return value | let([weights](int& it)
+        {
+            int sum = 0;
+            for(int w : weights)
+                sum += w * it;
+            return sum;
+        });
+}
+#else
+int weigh(int value, const std::array<int, 16>& weights)
+{
+    auto lambda = [weights](int& it)
+    {
+        int sum = 0;
+        for(int w : weights)
+            sum += w * it;
+        return sum;
+    };
+    return lambda(value);
+}
+#endif
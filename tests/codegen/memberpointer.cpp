@@ -0,0 +1,26 @@
+#include "scopefn.hpp"
+
+using namespace scopefn;
+
+struct Account : ScopeFunctions<Account>
+{
+    int balance = 0;
+    int fees = 0;
+    void charge() { balance -= fees; }
+};
+
+#if SCOPEFN_CODEGEN_VARIANT
+int settle(Account& account)
+{
+    return account.apply(member<&Account::charge>{})
+        | also(&Account::fees, [](int& it) { it = 0; })
+        | let(&Account::balance, [](int it) { return it * 2; });
+}
+#else
+int settle(Account& account)
+{
+    account.charge();
+    account.fees = 0;
+    return account.balance * 2;
+}
+#endif
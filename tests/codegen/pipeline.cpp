@@ -0,0 +1,22 @@
+#include "scopefn.hpp"
+
+using namespace scopefn;
+
+#if SCOPEFN_CODEGEN_VARIANT
+int transform(const int* input, int* output, int size)
+{
+    auto stages = let([](int& it) { return it * it; })
+                | also([](int& it) { it += 7; })
+                | let([](int& it) { return it / 2; });
+    for(int i = 0; i < size; i++)
+        output[i] = int(input[i]) | stages;
+    return size;
+}
+#else
+int transform(const int* input, int* output, int size)
+{
+    for(int i = 0; i < size; i++)
+        output[i] = (input[i] * input[i] + 7) / 2;
+    return size;
+}
+#endif
@@ -0,0 +1,24 @@
+#include "scopefntuple.hpp"
+
+using namespace scopefn;
+
+// also_all over a heterogeneous tuple must unroll into the same straight-line
+// code as configuring every object by hand.
+
+struct Motor { int rpm; int limit; };
+struct Sensor { float gain; int limit; };
+struct Valve { bool open; int limit; };
+
+#if SCOPEFN_CODEGEN_VARIANT
+void configure(Motor& motor, Sensor& sensor, Valve& valve, int limit)
+{
+    std::tie(motor, sensor, valve) | also_all([limit](auto& it) { it.limit = limit; });
+}
+#else
+void configure(Motor& motor, Sensor& sensor, Valve& valve, int limit)
+{
+    motor.limit = limit;
+    sensor.limit = limit;
+    valve.limit = limit;
+}
+#endif
@@ -0,0 +1,31 @@
+// Smoke test of the scopefn module, built with the BUILD_MODULE option. It
+// only checks that an importing TU compiles, links and runs, the behaviour is
+// covered by the header tests.
+
+// GCC resolves the std::source_location default arguments of the CRTP member
+// functions in the importing TU, so it needs the header
+#include <source_location>
+import scopefn;
+
+using namespace scopefn;
+
+struct Counter : ScopeFunctions<Counter>
+{
+    int value = 0;
+};
+
+int main()
+{
+    Counter counter;
+    int crtp = counter.also([](Counter& it) { it.value++; })
+                      .apply([self = &counter] { self->value++; })
+                      .let([](Counter& it) { return it.value; });
+
+    const Counter& constCounter = counter;
+    int constCrtp = constCounter.let([](const Counter& it) { return it.value * 2; });
+
+    int value = 1;
+    int freestanding = value | also([](int& it) { it += 2; }) | let([](int& it) { return it * 2; });
+
+    return crtp == 2 && constCrtp == 4 && freestanding == 6 ? 0 : 1;
+}
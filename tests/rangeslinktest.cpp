@@ -0,0 +1,17 @@
+// Built without TBB and optimizations: the range scope functions without an
+// execution policy must link without the parallel algorithms backend, which
+// libstdc++ pulls in with <execution>.
+
+#include <scopefnranges.hpp>
+#include <vector>
+
+using namespace scopefn;
+
+int main()
+{
+    std::vector<int> numbers{1, 2, 3};
+    std::vector<int> doubled = numbers
+        | also_each([](int& it) { it++; })
+        | let_each([](int& it) { return it * 2; });
+    return doubled == std::vector<int>{4, 6, 8} ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+#include "testentities.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <scopefnasync.hpp>
+
+using namespace scopefn;
+
+/**
+ * @brief Executor running tasks immediately on the calling thread and
+ * counting them, to check which executor the stages are submitted to.
+ */
+struct InlineExecutor
+{
+    template<typename Task>
+    void execute(Task&& task) { tasks++; task(); }
+
+    unsigned tasks = 0;
+};
+
+TEST(ScopeFunctionAsyncTests, LetAsyncTest)
+{
+    std::vector<int> vec{1, 2, 3};
+    std::future<int> sum = vec | let_async(thread_executor{}, [](std::vector<int>& it)
+                                           { return std::accumulate(it.begin(), it.end(), 0); });
+    ASSERT_EQ(sum.get(), 6);
+
+    InlineExecutor executor;
+    std::future<std::string> moved = std::string("a long string that is not in the small buffer")
+        | let_async(executor, [](std::string&& it) { return std::move(it); });
+    ASSERT_EQ(moved.get(), "a long string that is not in the small buffer");
+    ASSERT_EQ(executor.tasks, 1);
+
+    std::future<void> failed = vec | let_async(thread_executor{}, [](auto&) { throw std::runtime_error("failed"); });
+    ASSERT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(ScopeFunctionAsyncTests, AlsoAsyncTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    std::future<Person&> older = person | also_async(thread_executor{}, &Person::incrementAge);
+    Person& same = older.get();
+    ASSERT_EQ(&same, &person);
+    ASSERT_EQ(person.age, 21);
+
+    CopyCounter::reset();
+    InlineExecutor executor;
+    std::future<CopyCounter> counter = CopyCounter{} | also_async(executor, [](CopyCounter& it) { it.value = 5; });
+    ASSERT_EQ(counter.get().value, 5);
+    ASSERT_EQ(CopyCounter::copies, 0);
+}
+
+TEST(ScopeFunctionAsyncTests, AsyncChainTest)
+{
+    InlineExecutor executor;
+    std::vector<int> vec{1, 2, 3};
+    std::future<std::string> text = vec | also_async(executor, [](std::vector<int>& it) { it.push_back(4); })
+                                        | let_async(executor, [](std::vector<int>& it) { return it.size(); })
+                                        | let_async(executor, [](size_t size) { return std::to_string(size); });
+    ASSERT_EQ(text.get(), "4");
+    ASSERT_EQ(executor.tasks, 3);
+
+    auto stringify = let_async(thread_executor{}, [](int it) { return it * 2; })
+                   | let_async(thread_executor{}, [](int it) { return std::to_string(it); });
+    ASSERT_EQ((21 | stringify).get(), "42");
+}
+
+TEST(ScopeFunctionAsyncTests, OverlappingStagesTest)
+{
+    // Each stage waits for the other one, so they only finish if they run concurrently
+    std::promise<void> firstStarted, secondStarted;
+    std::shared_future<void> first = firstStarted.get_future().share();
+    std::shared_future<void> second = secondStarted.get_future().share();
+
+    std::future<bool> a = first | let_async(thread_executor{}, [&](auto&)
+    {
+        firstStarted.set_value();
+        return second.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    });
+    std::future<bool> b = second | let_async(thread_executor{}, [&](auto&)
+    {
+        secondStarted.set_value();
+        return first.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    });
+    ASSERT_TRUE(a.get());
+    ASSERT_TRUE(b.get());
+}
+
+/**
+ * @brief Executor queueing tasks without running them, standing in for a
+ * pool whose workers are all busy.
+ */
+struct BusyExecutor
+{
+    template<typename Task>
+    void execute(Task&& task) { queued.emplace_back(std::forward<Task>(task)); }
+
+    void runQueued()
+    {
+        for(auto& task : queued)
+            task();
+        queued.clear();
+    }
+
+    std::vector<std::function<void()>> queued;
+};
+
+TEST(ScopeFunctionAsyncTests, AlsoParallelTest)
+{
+    // Each lambda waits for the other one, so they only finish if they run concurrently
+    std::promise<void> firstStarted, secondStarted;
+    std::shared_future<void> first = firstStarted.get_future().share();
+    std::shared_future<void> second = secondStarted.get_future().share();
+    bool overlapped = true;
+
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    Person& same = person | also_parallel(
+        [&](Person& it)
+        {
+            firstStarted.set_value();
+            overlapped &= second.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+            it.age++;
+        },
+        [&](Person& it)
+        {
+            secondStarted.set_value();
+            overlapped &= first.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+            it.location = "Paris";
+        });
+    ASSERT_TRUE(overlapped);
+    ASSERT_EQ(&same, &person);
+    ASSERT_EQ(person.age, 21);
+    ASSERT_EQ(person.location, "Paris");
+
+    InlineExecutor executor;
+    std::atomic<int> calls = 0;
+    auto count = [&calls](Person&) { calls++; };
+    person | also_parallel(executor, count, count, count);
+    ASSERT_EQ(calls, 3);
+    ASSERT_EQ(executor.tasks, 2);
+    static_assert(std::is_same_v<decltype(also_parallel(executor, count).executor), InlineExecutor&>);
+    static_assert(std::is_same_v<decltype(also_parallel(count).executor), shared_pool_executor>);
+    static_assert(std::is_same_v<decltype(also_parallel_const(count).executor), shared_pool_executor>);
+}
+
+TEST(ScopeFunctionAsyncTests, SharedPoolTest)
+{
+    // The pool reuses its workers instead of starting a thread per task
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    auto record = [&](std::vector<int>&)
+    {
+        std::lock_guard lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    };
+    std::vector<int> vec{1, 2, 3};
+    for(int i = 0; i < 100; i++)
+        vec | also_parallel(record, record, record, record);
+    ASSERT_LE(threads.size(), std::max(1u, std::thread::hardware_concurrency()) + 1);
+
+    // Fan-outs nested in pool tasks don't wait for workers busy with their parents
+    std::atomic<int> leaves = 0;
+    auto leaf = [&leaves](std::vector<int>&) { leaves++; };
+    auto inner = [&](std::vector<int>& it) { it | also_parallel(leaf, leaf, leaf); };
+    vec | also_parallel(inner, inner, inner, inner);
+    ASSERT_EQ(leaves, 12);
+
+    std::future<int> sum = vec | let_async(shared_pool_executor{}, [](std::vector<int>& it)
+    {
+        return std::accumulate(it.begin(), it.end(), 0);
+    });
+    ASSERT_EQ(sum.get(), 6);
+}
+
+TEST(ScopeFunctionAsyncTests, SharedPoolChainTest)
+{
+    // Workers don't block on the future of a stage queued behind the one
+    // waiting for it, chains started by a worker go to its own queue
+    const unsigned chains = 4 * std::max(1u, std::thread::hardware_concurrency());
+    auto twoStages = let_async(shared_pool_executor{}, [](int it) { return it + 1; })
+                   | let_async(shared_pool_executor{}, [](int it) { return it * 2; });
+    auto threeStages = twoStages | let_async(shared_pool_executor{}, [](int it) { return it - 1; });
+
+    for(int round = 0; round < 20; round++)
+    {
+        std::vector<std::future<int>> two(chains);
+        std::vector<std::future<int>> three(chains);
+        std::future<void> started = 0 | let_async(shared_pool_executor{}, [&](int)
+        {
+            for(unsigned i = 0; i < chains; i++)
+            {
+                two[i] = int(i) | twoStages;
+                three[i] = int(i) | threeStages;
+            }
+        });
+        started.get();
+        for(unsigned i = 0; i < chains; i++)
+        {
+            ASSERT_EQ(two[i].get(), int(i + 1) * 2);
+            ASSERT_EQ(three[i].get(), int(i + 1) * 2 - 1);
+        }
+    }
+}
+
+TEST(ScopeFunctionAsyncTests, AlsoParallelBusyExecutorTest)
+{
+    // The calling thread runs the lambdas the executor doesn't get to
+    BusyExecutor executor;
+    std::vector<int> vec{1, 2, 3};
+    std::thread::id caller = std::this_thread::get_id();
+    bool onCaller = true;
+    auto check = [&](std::vector<int>&) { onCaller &= std::this_thread::get_id() == caller; };
+    std::vector<int> moved = std::move(vec) | also_parallel(executor, check, check)
+                                            | also([](std::vector<int>& it) { it.push_back(4); });
+    ASSERT_TRUE(onCaller);
+    ASSERT_EQ(moved.size(), 4);
+    ASSERT_EQ(executor.queued.size(), 1);
+    executor.runQueued();
+
+    auto fail = [](std::vector<int>&) { throw std::runtime_error("failed"); };
+    ASSERT_THROW(moved | also_parallel(executor, check, fail), std::runtime_error);
+    executor.runQueued();
+}
+
+TEST(ScopeFunctionAsyncTests, AlsoParallelConstTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    std::atomic<unsigned> total = 0;
+    InlineExecutor executor;
+    const auto stage = also_parallel_const(executor,
+        [&total](const Person& it) { total += it.age; },
+        [&total](const auto& it) { total += unsigned(it.name.size()); });
+    Person& same = person | stage;
+    ASSERT_EQ(&same, &person);
+    ASSERT_EQ(total, 25);
+}
@@ -0,0 +1,205 @@
+#include "testentities.hpp"
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <gtest/gtest.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <scopefncoroutine.hpp>
+
+using namespace scopefn;
+
+/**
+ * @brief Awaitable suspending the awaiting coroutine until the test resumes
+ * it with Deferred::resumeAll, then producing value. Stands in for an
+ * asynchronous I/O operation.
+ */
+template<typename T>
+struct Deferred
+{
+    static inline std::deque<std::coroutine_handle<>> pending;
+    static void resumeAll()
+    {
+        while(!pending.empty())
+        {
+            std::coroutine_handle<> handle = pending.front();
+            pending.pop_front();
+            handle.resume();
+        }
+    }
+
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle) { pending.push_back(handle); }
+    T await_resume() { return value; }
+
+    T value;
+};
+
+/**
+ * @brief Eager coroutine type running a request handler and keeping its
+ * result once it finishes.
+ */
+template<typename T>
+struct Handler
+{
+    struct promise_type
+    {
+        Handler get_return_object() { return Handler{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_value(T value) { result.emplace(std::move(value)); }
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        std::optional<T> result;
+        std::exception_ptr exception;
+    };
+
+    explicit Handler(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+    Handler(Handler&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    ~Handler()
+    {
+        if(handle)
+            handle.destroy();
+    }
+
+    bool done() const { return handle.done(); }
+    T result() const
+    {
+        if(handle.promise().exception)
+            std::rethrow_exception(handle.promise().exception);
+        return *handle.promise().result;
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+TEST(ScopeFunctionCoroutineTests, AwaitableChainTest)
+{
+    std::string log;
+    auto handler = [&log]() -> Handler<int>
+    {
+        co_return co_await (Deferred<int>{21} | let([](int it) { return it * 2; })
+                                              | also([&log](int it) { log = std::to_string(it); }));
+    }();
+    ASSERT_FALSE(handler.done());
+    ASSERT_TRUE(log.empty());
+
+    Deferred<int>::resumeAll();
+    ASSERT_TRUE(handler.done());
+    ASSERT_EQ(handler.result(), 42);
+    ASSERT_EQ(log, "42");
+}
+
+TEST(ScopeFunctionCoroutineTests, CoroutineLambdaTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    std::string log;
+    auto fetchAge = [](Person& it) { return Deferred<unsigned>{it.age}; };
+    auto handler = [&]() -> Handler<unsigned>
+    {
+        co_return co_await (person | let(fetchAge) | also([&log](unsigned it) { log = std::to_string(it); }));
+    }();
+    Deferred<unsigned>::resumeAll();
+    ASSERT_EQ(handler.result(), 20);
+    ASSERT_EQ(log, "20");
+
+    Deferred<Person> deferred{person};
+    auto older = [&]() -> Handler<unsigned>
+    {
+        co_return co_await (deferred | also(&Person::incrementAge) | let([](Person& it) { return it.age; }));
+    }();
+    Deferred<Person>::resumeAll();
+    ASSERT_EQ(older.result(), 21);
+    ASSERT_EQ(person.age, 20);
+}
+
+TEST(ScopeFunctionCoroutineTests, AwaitedOptionalTest)
+{
+    int calls = 0;
+    auto handler = [&calls]() -> Handler<std::optional<int>>
+    {
+        co_return co_await (Deferred<std::optional<int>>{} | let([&calls](int it) { calls++; return it * 2; }));
+    }();
+    auto present = [&calls]() -> Handler<std::optional<int>>
+    {
+        co_return co_await (Deferred<std::optional<int>>{21} | let([&calls](int it) { calls++; return it * 2; }));
+    }();
+    Deferred<std::optional<int>>::resumeAll();
+    ASSERT_FALSE(handler.result().has_value());
+    ASSERT_EQ(present.result(), 42);
+    ASSERT_EQ(calls, 1);
+
+#if __cpp_lib_expected
+    // The error is an int, as GCC 12 destroys awaited non-trivial temporaries twice
+    using Parsed = std::expected<int, int>;
+    auto failed = [&calls]() -> Handler<Parsed>
+    {
+        co_return co_await (Deferred<Parsed>{std::unexpected(404)}
+            | let([&calls](int it) { calls++; return it + 1; })
+            | also([&calls](int) { calls++; }));
+    }();
+    Deferred<Parsed>::resumeAll();
+    ASSERT_EQ(failed.result().error(), 404);
+    ASSERT_EQ(calls, 1);
+#endif
+}
+
+TEST(ScopeFunctionCoroutineTests, AwaitedTakeIfTest)
+{
+    auto adult = []() -> Handler<std::optional<int>>
+    {
+        co_return co_await (Deferred<int>{21}
+            | take_if([](int it) { return it >= 18; })
+            | let([](int& it) { return it * 2; }));
+    }();
+    auto minor = []() -> Handler<std::optional<int>>
+    {
+        co_return co_await (Deferred<int>{12}
+            | take_unless([](int it) { return it < 18; })
+            | let([](int& it) { return it * 2; }));
+    }();
+    Deferred<int>::resumeAll();
+    ASSERT_EQ(adult.result(), 42);
+    ASSERT_FALSE(minor.result().has_value());
+
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    auto older = [&person]() -> Handler<std::optional<unsigned>>
+    {
+        co_return co_await (Deferred<Person&>{person}
+            | take_if([](Person& it) { return it.age >= 18; })
+            | also(&Person::incrementAge)
+            | let(&Person::age));
+    }();
+    Deferred<Person&>::resumeAll();
+    ASSERT_EQ(older.result(), 21u);
+    ASSERT_EQ(person.age, 21);
+}
+
+TEST(ScopeFunctionCoroutineTests, SuspendingStagesTest)
+{
+    auto handler = []() -> Handler<std::string>
+    {
+        co_return co_await (Deferred<int>{1}
+            | let([](int it) { return Deferred<int>{it + 1}; })
+            | let([](int it) { return Deferred<int>{it * 10}; })
+            | let([](int it) { return std::to_string(it); }));
+    }();
+    Deferred<int>::resumeAll();
+    ASSERT_TRUE(handler.done());
+    ASSERT_EQ(handler.result(), "20");
+
+    auto stages = let([](int it) { return it + 1; }) | let([](int it) { return Deferred<int>{it * 2}; });
+    auto piped = [&]() -> Handler<int> { co_return co_await (Deferred<int>{2} | stages); }();
+    Deferred<int>::resumeAll();
+    ASSERT_EQ(piped.result(), 6);
+
+    auto failing = []() -> Handler<int>
+    {
+        co_return co_await (Deferred<int>{1}
+            | let([](int) -> Deferred<int> { throw std::runtime_error("failed"); })
+            | let([](int it) { return it; }));
+    }();
+    Deferred<int>::resumeAll();
+    ASSERT_THROW(failing.result(), std::runtime_error);
+}
@@ -0,0 +1,112 @@
+#include "allocationcounter.hpp"
+#include "testentities.hpp"
+#include <array>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+#include <scopefndynamic.hpp>
+
+using namespace scopefn;
+using allocationcounter::countAllocations;
+
+/**
+ * @brief Memory resource counting the allocations it passes on to the
+ * default resource.
+ */
+struct CountingResource : std::pmr::memory_resource
+{
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocations++;
+        return std::pmr::get_default_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+    {
+        deallocations++;
+        std::pmr::get_default_resource()->deallocate(pointer, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    unsigned allocations = 0;
+    unsigned deallocations = 0;
+};
+
+TEST(ScopeFunctionDynamicTests, RuntimeStagesTest)
+{
+    std::vector<std::string> config{"double", "increment", "double"};
+    dynamic_pipeline<int> stages;
+    for(const std::string& name : config)
+    {
+        if(name == "double")
+            stages.push_back(let([](int& it) { return it * 2; }));
+        else
+            stages.push_back(also([](int& it) { it++; }));
+    }
+    ASSERT_EQ(stages.size(), 3);
+
+    int value = 5;
+    int& same = value | stages;
+    ASSERT_EQ(&same, &value);
+    ASSERT_EQ(value, 22);
+    ASSERT_EQ(1 | stages, 6);
+
+    std::optional<int> empty;
+    ASSERT_FALSE(empty | stages);
+    ASSERT_EQ(std::optional<int>(0) | stages, 2);
+}
+
+TEST(ScopeFunctionDynamicTests, StagesAndPipelinesTest)
+{
+    dynamic_pipeline<Person> stages;
+    std::string log;
+    stages.push_back(also(&Person::incrementAge) | also(&Person::location, [](std::string& it) { it = "Paris"; }))
+          .push_back(run([&log] { log += "run"; }));
+
+    dynamic_pipeline<Person> outer;
+    outer.push_back(std::move(stages)).push_back(also([](Person& it) { it.name += "!"; }));
+    ASSERT_TRUE(stages.empty());
+
+    Person person = Person{.name = "Alice", .location = "London", .age = 20} | outer;
+    ASSERT_EQ(person.age, 21);
+    ASSERT_EQ(person.location, "Paris");
+    ASSERT_EQ(person.name, "Alice!");
+    ASSERT_EQ(log, "run");
+}
+
+TEST(ScopeFunctionDynamicTests, MemoryResourceTest)
+{
+    CountingResource resource;
+    {
+        dynamic_pipeline<int> stages(&resource);
+        std::array<int, 64> weights{};
+        weights.fill(1);
+        stages.push_back(also([weights](int& it) { for(int w : weights) it += w; }))
+              .push_back(let([](int& it) { return it - 1; }));
+        ASSERT_EQ(resource.allocations, 2);
+        ASSERT_EQ(stages.memory_resource(), &resource);
+        ASSERT_EQ(0 | stages, 63);
+
+        dynamic_pipeline<int> moved = std::move(stages);
+        ASSERT_EQ(0 | moved, 63);
+        ASSERT_EQ(resource.deallocations, 0);
+    }
+    ASSERT_EQ(resource.deallocations, 2);
+
+    // A monotonic arena on the stack builds and runs the pipeline without any
+    // heap allocation
+    std::array<std::byte, 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    int result = 0;
+    size_t allocations = countAllocations([&]
+    {
+        dynamic_pipeline<int> stages(&arena);
+        for(int i = 0; i < 8; i++)
+            stages.push_back(also([i](int& it) { it += i; }));
+        result = 0 | stages;
+    });
+    ASSERT_EQ(allocations, 0);
+    ASSERT_EQ(result, 28);
+}
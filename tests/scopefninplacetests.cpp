@@ -0,0 +1,84 @@
+#include "allocationcounter.hpp"
+#include "testentities.hpp"
+#include <array>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <scopefninplace.hpp>
+
+using namespace scopefn;
+using allocationcounter::countAllocations;
+
+TEST(ScopeFunctionInplaceTests, CallTest)
+{
+    inplace_function<int(int, int)> add = [](int a, int b) { return a + b; };
+    ASSERT_TRUE(add);
+    ASSERT_EQ(add(2, 3), 5);
+
+    int calls = 0;
+    inplace_function<void()> count = [&calls] { calls++; };
+    const auto& view = count;
+    view();
+    count();
+    ASSERT_EQ(calls, 2);
+
+    inplace_function<void()> empty;
+    ASSERT_FALSE(empty);
+
+    int value = 1;
+    inplace_function<void(int&)> discard{[](int& x) { return ++x; }};
+    discard(value);
+    ASSERT_EQ(value, 2);
+
+    inplace_function<std::string(std::string&&)> take = [](std::string&& it) { return std::move(it); };
+    ASSERT_EQ(take(std::string("a long string that is not in the small buffer")),
+              "a long string that is not in the small buffer");
+    static_assert(sizeof(inplace_function<void(), 64>) <= 64 + 2 * sizeof(void*) + alignof(std::max_align_t));
+}
+
+TEST(ScopeFunctionInplaceTests, CopyMoveTest)
+{
+    CopyCounter::reset();
+    inplace_function<int()> original = [counter = CopyCounter{}]() mutable { return ++counter.value; };
+    ASSERT_EQ(original(), 1);
+
+    inplace_function<int()> copy = original;
+    ASSERT_EQ(CopyCounter::copies, 1);
+    ASSERT_EQ(copy(), 2);
+    ASSERT_EQ(original(), 2);
+
+    inplace_function<int()> moved = std::move(copy);
+    ASSERT_EQ(CopyCounter::copies, 1);
+    ASSERT_EQ(moved(), 3);
+
+    original = moved;
+    ASSERT_EQ(original(), 4);
+    moved = inplace_function<int()>([] { return 0; });
+    ASSERT_EQ(moved(), 0);
+}
+
+TEST(ScopeFunctionInplaceTests, StorableStagesTest)
+{
+    using handler = also<inplace_function<void(Person&), 64>>;
+    std::array<int, 12> bonus{};
+    bonus.fill(1);
+    std::vector<handler> handlers;
+    handlers.reserve(3);
+
+    size_t allocations = countAllocations([&]
+    {
+        handlers.push_back(handler(&Person::incrementAge));
+        handlers.push_back(handler([bonus](Person& it) { for(int b : bonus) it.age += b; }));
+        handlers.push_back(handler([](Person& it) { it.location = "Paris"; }));
+    });
+    ASSERT_EQ(allocations, 0);
+
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    for(handler& stage : handlers)
+        person | stage;
+    ASSERT_EQ(person.age, 33);
+    ASSERT_EQ(person.location, "Paris");
+
+    auto name = let<inplace_function<std::string(const Person&)>>([](const Person& it) { return it.name; });
+    ASSERT_EQ(person | name, "Alice");
+}
@@ -0,0 +1,76 @@
+#include "testentities.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <scopefnlazy.hpp>
+
+using namespace scopefn;
+
+TEST(ScopeFunctionLazyTests, FirstAccessTest)
+{
+    unsigned calls = 0;
+    lazy person([&calls] { calls++; return Person{.name = "Alice", .location = "London", .age = 20}; });
+    ASSERT_EQ(calls, 0);
+    ASSERT_FALSE(person.initialized());
+
+    ASSERT_EQ(person->name, "Alice");
+    ASSERT_TRUE(person.initialized());
+    person.get().incrementAge();
+    ASSERT_EQ((*person).age, 21);
+    ASSERT_EQ(calls, 1);
+
+    const auto& view = person;
+    ASSERT_EQ(view->location, "London");
+    ASSERT_EQ(calls, 1);
+}
+
+TEST(ScopeFunctionLazyTests, DeferredStagesTest)
+{
+    std::string log;
+    auto length = lazy([&log] { log += "load "; return std::string("config"); })
+        | also([&log](std::string& it) { log += "validate " + it; })
+        | let([](std::string& it) { return it.size(); });
+    ASSERT_TRUE(log.empty());
+    ASSERT_EQ(length.get(), 6);
+    ASSERT_EQ(log, "load validate config");
+
+    // Chained after a named lazy value the stages access it immediately
+    lazy person([] { return Person{.name = "Alice", .location = "London", .age = 20}; });
+    Person& same = person | also(&Person::incrementAge);
+    ASSERT_EQ(&same, &person.get());
+    ASSERT_EQ(person | let([](Person& it) { return it.age; }), 21);
+}
+
+TEST(ScopeFunctionLazyTests, RetryAfterExceptionTest)
+{
+    unsigned calls = 0;
+    lazy value([&calls]
+    {
+        if(calls++ == 0)
+            throw std::runtime_error("failed");
+        return 42;
+    });
+    ASSERT_THROW(value.get(), std::runtime_error);
+    ASSERT_FALSE(value.initialized());
+    ASSERT_EQ(value.get(), 42);
+    ASSERT_EQ(calls, 2);
+}
+
+TEST(ScopeFunctionLazyTests, ConcurrentAccessTest)
+{
+    std::atomic<unsigned> calls = 0;
+    lazy value([&calls] { calls++; return std::vector<int>(1000, 1); });
+
+    std::vector<std::thread> threads;
+    std::atomic<unsigned> sizes = 0;
+    for(int i = 0; i < 8; i++)
+        threads.emplace_back([&] { sizes += value->size(); });
+    for(std::thread& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(calls, 1);
+    ASSERT_EQ(sizes, 8000);
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <source_location>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <scopefnprofile.hpp>
+
+using namespace scopefn;
+
+/**
+ * @brief Entity whose scope methods are recorded by the profiler.
+ */
+struct ProfiledPoint : ScopeFunctions<ProfiledPoint, profile::tracer>
+{
+    int x = 0;
+};
+
+static const profile::entry* findEntry(const std::vector<profile::entry>& entries, unsigned line)
+{
+    auto match = std::find_if(entries.begin(), entries.end(), [line](const profile::entry& it) { return it.line == line; });
+    return match == entries.end() ? nullptr : &*match;
+}
+
+TEST(ScopeFunctionProfileTests, CallSiteTest)
+{
+    profile::reset();
+    ProfiledPoint point;
+    // Every call site line is captured right before the call on the next line
+    unsigned alsoLine = 0;
+    for(int i = 0; i < 10; i++)
+    {
+        alsoLine = std::source_location::current().line() + 1;
+        point.also([](ProfiledPoint& it) { it.x++; });
+    }
+    const unsigned letLine = std::source_location::current().line() + 1;
+    int y = point.let([](ProfiledPoint& it) { return it.x * 2; });
+    std::vector<int> vec{1, 2, 3};
+    const unsigned tracedLine = std::source_location::current().line() + 1;
+    auto sum = vec | let_traced(profile::tracer{}, [](std::vector<int>& it) { return std::accumulate(it.begin(), it.end(), 0); });
+    ASSERT_EQ(y, 20);
+    ASSERT_EQ(sum, 6);
+
+    std::vector<profile::entry> entries = profile::snapshot();
+    const profile::entry* also = findEntry(entries, alsoLine);
+    ASSERT_NE(also, nullptr);
+    ASSERT_STREQ(also->function, "also");
+    ASSERT_EQ(also->calls, 10);
+    ASSERT_EQ(std::accumulate(also->histogram.begin(), also->histogram.end(), std::uint64_t(0)), 10);
+    ASSERT_NE(std::string(also->file).find("scopefnprofiletests.cpp"), std::string::npos);
+
+    const profile::entry* let = findEntry(entries, letLine);
+    ASSERT_NE(let, nullptr);
+    ASSERT_STREQ(let->function, "let");
+    ASSERT_EQ(let->calls, 1);
+
+    const profile::entry* traced = findEntry(entries, tracedLine);
+    ASSERT_NE(traced, nullptr);
+    ASSERT_EQ(traced->calls, 1);
+    ASSERT_TRUE(std::is_sorted(entries.begin(), entries.end(), [](const profile::entry& a, const profile::entry& b)
+                               { return a.nanoseconds > b.nanoseconds; }));
+
+    profile::reset();
+    ASSERT_TRUE(profile::snapshot().empty());
+}
+
+TEST(ScopeFunctionProfileTests, ThreadsTest)
+{
+    profile::reset();
+    std::atomic<unsigned> line = 0;
+    auto work = [&line]
+    {
+        ProfiledPoint point;
+        for(int i = 0; i < 1000; i++)
+        {
+            line.store(std::source_location::current().line() + 1, std::memory_order_relaxed);
+            point.apply([] {});
+        }
+    };
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; i++)
+        threads.emplace_back(work);
+    for(std::thread& thread : threads)
+        thread.join();
+
+    // The statistics of finished threads are kept and merged
+    std::vector<profile::entry> entries = profile::snapshot();
+    ASSERT_EQ(entries.size(), 1);
+    ASSERT_EQ(entries[0].line, line.load());
+    ASSERT_EQ(entries[0].calls, 4000);
+    ASSERT_EQ(profile::dropped(), 0);
+
+    std::ostringstream out;
+    profile::dump(out);
+    ASSERT_NE(out.str().find("apply at "), std::string::npos);
+    ASSERT_NE(out.str().find("calls 4000"), std::string::npos);
+}
+
+TEST(ScopeFunctionProfileTests, ExitedThreadsTest)
+{
+    profile::reset();
+    scopefn_internal::ProfileRegistry& registry = scopefn_internal::ProfileRegistry::instance();
+    std::atomic<unsigned> line = 0;
+    for(int i = 0; i < 50; i++)
+    {
+        std::thread([&line]
+        {
+            ProfiledPoint point;
+            line.store(std::source_location::current().line() + 1, std::memory_order_relaxed);
+            point.apply([] {});
+        }).join();
+    }
+
+    // The tables of exited threads are merged into one and freed
+    {
+        std::lock_guard lock(registry.mutex);
+        ASSERT_LE(registry.threads.size(), 2);
+    }
+    std::vector<profile::entry> entries = profile::snapshot();
+    const profile::entry* site = findEntry(entries, line.load());
+    ASSERT_NE(site, nullptr);
+    ASSERT_EQ(site->calls, 50);
+
+    testing::internal::CaptureStderr();
+    profile::dump();
+    ASSERT_NE(testing::internal::GetCapturedStderr().find("calls 50"), std::string::npos);
+
+    profile::reset();
+    ASSERT_EQ(findEntry(profile::snapshot(), line.load()), nullptr);
+}
@@ -0,0 +1,222 @@
+#include "testentities.hpp"
+#include <array>
+#include <chrono>
+#include <deque>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <span>
+#include <string>
+#include <thread>
+#include <scopefnparallel.hpp>
+
+using namespace scopefn;
+
+TEST(ScopeFunctionRangesTests, AlsoEachTest)
+{
+    std::vector<int> vec{1, 2, 3};
+    vec | also_each([](int& it) { it *= 2; })
+        | also_each([](auto& it) { it += 1; });
+    ASSERT_EQ(vec, (std::vector<int>{3, 5, 7}));
+
+    std::vector<int> large(100000);
+    std::iota(large.begin(), large.end(), 0);
+    long sum = large | also_each(std::execution::par_unseq, [](int& it) { it *= 2; })
+                     | let([](std::vector<int>& it) { return std::accumulate(it.begin(), it.end(), 0L); });
+    ASSERT_EQ(sum, 99999L * 100000L);
+
+    std::vector<Person> people(3, Person{.name = "Alice", .location = "London", .age = 20});
+    people | also_each(std::execution::par, &Person::incrementAge);
+    ASSERT_EQ(people[2].age, 21);
+
+    std::vector<unsigned> ages = people | let_each(&Person::age);
+    ASSERT_EQ(ages, (std::vector<unsigned>{21, 21, 21}));
+}
+
+TEST(ScopeFunctionRangesTests, LetEachTest)
+{
+    std::vector<std::string> names{"Alice", "Bob"};
+    std::vector<size_t> sizes = names | let_each([](std::string& it) { return it.size(); });
+    ASSERT_EQ(sizes, (std::vector<size_t>{5, 3}));
+
+    std::vector<int> large(100000, 3);
+    std::vector<long> squares = large | let_each(std::execution::par_unseq, [](int& it) { return long(it) * it; });
+    ASSERT_EQ(squares.size(), 100000);
+    ASSERT_EQ(squares.back(), 9);
+
+    // Not a common range, the end of take over an unbounded iota is a sentinel
+    std::vector<int> taken = std::views::iota(1) | std::views::take(4)
+        | let_each(std::execution::par, [](int it) { return it * it; });
+    ASSERT_EQ(taken, (std::vector<int>{1, 4, 9, 16}));
+
+    std::vector<std::string> moved = std::vector<std::string>{"a long string that is not in the small buffer"}
+        | let_each([](std::string&& it) { return std::move(it); });
+    ASSERT_EQ(moved[0], "a long string that is not in the small buffer");
+
+    int raw[] = {1, 2, 3};
+    ASSERT_EQ(raw | let_each([](int& it) { return it * 10; }), (std::vector<int>{10, 20, 30}));
+}
+
+TEST(ScopeFunctionRangesTests, ContiguousArithmeticTest)
+{
+    std::vector<float> samples(1001);
+    std::iota(samples.begin(), samples.end(), 0.0f);
+    std::vector<double> scaled = samples | let_each([](float& it) { return it * 0.5; });
+    ASSERT_EQ(scaled.size(), 1001);
+    ASSERT_EQ(scaled[1000], 500.0);
+
+    std::vector<int> widened = std::vector<short>{1, 2, 3} | let_each([](short&& it) { return it * 100000; });
+    ASSERT_EQ(widened, (std::vector<int>{100000, 200000, 300000}));
+
+    // The lambda may read other elements of the range
+    std::array<int, 4> values{1, 2, 3, 4};
+    std::vector<int> prefix = values | let_each([&values](int& it) { return it + values[0]; });
+    ASSERT_EQ(prefix, (std::vector<int>{2, 3, 4, 5}));
+
+    static_assert([]
+    {
+        std::array<int, 3> arr{1, 2, 3};
+        std::vector<int> doubled = arr | let_each([](int& it) { return it * 2; });
+        return doubled[0] + doubled[1] + doubled[2];
+    }() == 12);
+
+    // Spans take the same indexed path as the containers they refer to
+    static_assert(!scopefn_internal::LazyView<std::span<const int>> &&
+                  scopefn_internal::ContiguousArithmetic<std::span<const int>&>);
+    std::vector<int> window = std::span<const int>(values).subspan(1, 2) | let_each([](int it) { return it * 3; });
+    ASSERT_EQ(window, (std::vector<int>{6, 9}));
+}
+
+TEST(ScopeFunctionRangesTests, RangePipelineTest)
+{
+    auto doubledSizes = also_each([](std::string& it) { it += it; })
+                      | let_each([](std::string& it) { return it.size(); });
+    std::vector<std::string> names{"Alice", "Bob"};
+    ASSERT_EQ(names | doubledSizes, (std::vector<size_t>{10, 6}));
+
+    static_assert([]
+    {
+        std::array<int, 3> arr{1, 2, 3};
+        arr | also_each([](int& it) { it *= 3; });
+        return arr[0] + arr[1] + arr[2];
+    }() == 18);
+    static_assert(noexcept(std::declval<std::vector<int>&>() | also_each([](int&) noexcept {})));
+}
+
+TEST(ScopeFunctionRangesTests, LazyViewTest)
+{
+    int calls = 0;
+    auto squares = std::views::iota(0)
+        | std::views::filter([](int it) { return it % 2 == 0; })
+        | let_each([&calls](int it) { calls++; return it * it; })
+        | std::views::take(3);
+    ASSERT_EQ(calls, 0);
+
+    std::vector<int> result;
+    for(int square : squares)
+        result.push_back(square);
+    ASSERT_EQ(result, (std::vector<int>{0, 4, 16}));
+    ASSERT_EQ(calls, 3);
+
+    std::vector<Person> people(3, Person{.name = "Alice", .location = "London", .age = 20});
+    auto older = people | std::views::filter([](Person&) { return true; }) | also_each(&Person::incrementAge);
+    ASSERT_EQ(people[0].age, 20);
+    for(Person& person : older)
+        ASSERT_EQ(person.age, 21);
+    ASSERT_EQ(people[2].age, 21);
+
+    std::vector<std::string> names{"a long string that is not in the small buffer"};
+    auto copies = std::views::all(names)
+        | let_each([](auto&& it) { return std::string(std::forward<decltype(it)>(it)); });
+    for(const std::string& copy : copies)
+        ASSERT_EQ(copy, names[0]);
+    ASSERT_EQ(names[0], "a long string that is not in the small buffer");
+}
+
+TEST(ScopeFunctionRangesTests, SpanTest)
+{
+    // Spans and string views refer to their elements, so they are visited
+    // eagerly like containers instead of returning a lazy view
+    std::vector<int> numbers{1, 2, 3};
+    std::span<int> span(numbers);
+    span | also_each([](int& it) { it *= 10; });
+    ASSERT_EQ(numbers, (std::vector<int>{10, 20, 30}));
+    std::span(numbers).subspan(1) | also_each([](int& it) { it++; });
+    ASSERT_EQ(numbers, (std::vector<int>{10, 21, 31}));
+
+    auto halves = span | let_each([](int& it) { return it / 2; });
+    static_assert(std::is_same_v<decltype(halves), std::vector<int>>);
+    ASSERT_EQ(halves, (std::vector<int>{5, 10, 15}));
+
+    std::string_view text = "abc";
+    auto codes = text | let_each([](char it) { return int(it); });
+    static_assert(std::is_same_v<decltype(codes), std::vector<int>>);
+    ASSERT_EQ(codes, (std::vector<int>{97, 98, 99}));
+
+    // The elements of a temporary span belong to someone else and aren't moved
+    std::vector<std::string> names{"a long string that is not in the small buffer"};
+    auto copies = std::span(names) | let_each([](auto&& it) { return std::string(std::forward<decltype(it)>(it)); });
+    ASSERT_EQ(copies[0], names[0]);
+    ASSERT_EQ(names[0], "a long string that is not in the small buffer");
+
+    std::span(numbers) | batch(2) | also_each([](std::span<int> it) { it[0] = 0; });
+    ASSERT_EQ(numbers, (std::vector<int>{0, 21, 0}));
+}
+
+TEST(ScopeFunctionRangesTests, BatchTest)
+{
+    std::vector<int> numbers(10);
+    std::iota(numbers.begin(), numbers.end(), 0);
+    std::vector<std::size_t> sizes;
+    numbers | batch(4) | also_each([&sizes](std::span<int> it) { sizes.push_back(it.size()); });
+    ASSERT_EQ(sizes, (std::vector<std::size_t>{4, 4, 2}));
+
+    // Lvalue contiguous ranges are batched in place
+    auto sums = numbers | batch(5) | let_each([](std::span<int> it) { return std::accumulate(it.begin(), it.end(), 0); });
+    ASSERT_EQ(sums, (std::vector<int>{10, 35}));
+    numbers | batch(3) | also_each([](std::span<int> it) { it[0] = -1; });
+    ASSERT_EQ(numbers[9], -1);
+    ASSERT_EQ((numbers | batch(3)).size(), 4);
+    ASSERT_EQ((numbers | batch(0)).size(), 1);
+
+    const std::deque<int> queue{1, 2, 3};
+    ASSERT_EQ(queue | batch(2) | let_each([](std::span<int> it) { return it.size(); }),
+              (std::vector<std::size_t>{2, 1}));
+
+    CopyCounter::reset();
+    std::vector<CopyCounter> counters(6);
+    std::move(counters) | batch(2) | also_each([](std::span<CopyCounter> it) { it[0].value = 1; });
+    ASSERT_EQ(CopyCounter::copies, 0);
+    ASSERT_EQ(CopyCounter::moves, 0);
+
+    std::deque<CopyCounter> queued(5);
+    CopyCounter::reset();
+    auto filled = std::move(queued) | batch(2);
+    ASSERT_EQ(CopyCounter::copies, 0);
+    ASSERT_EQ(CopyCounter::moves, 5);
+    ASSERT_EQ(filled.size(), 3);
+}
+
+TEST(ScopeFunctionRangesTests, LazyBatchTest)
+{
+    std::vector<std::size_t> sizes;
+    auto batches = std::views::iota(0, 7)
+        | batch(3)
+        | also_each([&sizes](std::span<int> it) { sizes.push_back(it.size()); });
+    ASSERT_TRUE(sizes.empty());
+    std::vector<int> firsts;
+    for(std::span<int> it : batches)
+        firsts.push_back(it[0]);
+    ASSERT_EQ(sizes, (std::vector<std::size_t>{3, 3, 1}));
+    ASSERT_EQ(firsts, (std::vector<int>{0, 3, 6}));
+
+    // Elements trickling in slower than the timeout are flushed in pairs
+    auto slow = std::views::iota(0, 6) | std::views::transform([](int it)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return it;
+    });
+    sizes.clear();
+    for(std::span<int> it : slow | batch(100, std::chrono::milliseconds(1)))
+        sizes.push_back(it.size());
+    ASSERT_EQ(sizes, (std::vector<std::size_t>{2, 2, 2}));
+}
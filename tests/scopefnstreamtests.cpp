@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <gtest/gtest.h>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <scopefnranges.hpp>
+#include <scopefnstream.hpp>
+
+using namespace scopefn;
+
+/**
+ * @brief Reader handing out the characters of a string, standing in for a
+ * file or a socket.
+ */
+struct StringReader
+{
+    std::size_t operator()(std::span<char> chunk)
+    {
+        std::size_t count = std::min(chunk.size(), text.size() - position);
+        std::memcpy(chunk.data(), text.data() + position, count);
+        position += count;
+        reads++;
+        return count;
+    }
+
+    std::string text;
+    std::size_t position = 0;
+    unsigned reads = 0;
+};
+
+TEST(ScopeFunctionStreamTests, ChunkedStagesTest)
+{
+    std::string output;
+    std::size_t largest = 0;
+    std::size_t chunks = (stream(StringReader{"hello streaming world"}, 4)
+        | also([&largest](std::vector<char>& it) { largest = std::max(largest, it.size()); })
+        | let_each([](char& it) { return char(std::toupper(it)); })
+        | also([&output](std::vector<char>& it) { output.append(it.begin(), it.end()); })).run();
+
+    ASSERT_EQ(output, "HELLO STREAMING WORLD");
+    ASSERT_EQ(chunks, 6);
+    ASSERT_EQ(largest, 4);
+
+    std::vector<int> numbers;
+    int next = 0;
+    auto counter = [&next](std::span<int> chunk) -> std::size_t
+    {
+        if(next >= 10)
+            return 0;
+        for(int& it : chunk)
+            it = next++;
+        return chunk.size();
+    };
+    (stream(counter, 5) | also_each([&numbers](int& it) { numbers.push_back(it); })).run();
+    ASSERT_EQ(numbers.size(), 10);
+    ASSERT_EQ(numbers.back(), 9);
+
+    ASSERT_EQ(stream<char>([](auto) { return std::size_t(0); }, 16).run(), 0);
+
+    std::vector<std::string> words;
+    (stream(StringReader{"batched into words"}, 6)
+        | batch(3)
+        | also_each([&words](std::span<char> it) { words.emplace_back(it.begin(), it.end()); })).run();
+    ASSERT_EQ(words, (std::vector<std::string>{"bat", "che", "d i", "nto", " wo", "rds"}));
+}
+
+TEST(ScopeFunctionStreamTests, OverlappedReadTest)
+{
+    // The first chunk is only done once the second one is being read
+    std::promise<void> secondRead;
+    std::future<void> secondStarted = secondRead.get_future();
+    unsigned reads = 0;
+    auto reader = [&](std::span<char> chunk) -> std::size_t
+    {
+        if(reads++ == 1)
+            secondRead.set_value();
+        return reads <= 3 ? chunk.size() : 0;
+    };
+    bool overlapped = false;
+    unsigned processed = 0;
+    (stream(reader, 8) | also([&](std::vector<char>&)
+    {
+        if(processed++ == 0)
+            overlapped = secondStarted.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    })).run();
+    ASSERT_TRUE(overlapped);
+    ASSERT_EQ(processed, 3);
+}
+
+TEST(ScopeFunctionStreamTests, ExceptionTest)
+{
+    auto failingStage = stream(StringReader{std::string(100, 'x')}, 10)
+        | also([](std::vector<char>&) { throw std::runtime_error("stage failed"); });
+    ASSERT_THROW(failingStage.run(), std::runtime_error);
+    ASSERT_LE(failingStage.reader.reads, 3);
+
+    unsigned processed = 0;
+    auto failingReader = [&processed](std::span<char> chunk) -> std::size_t
+    {
+        if(processed > 0)
+            throw std::runtime_error("read failed");
+        return chunk.size();
+    };
+    auto stages = stream(failingReader, 10) | also([&processed](std::vector<char>&) { processed++; });
+    ASSERT_THROW(stages.run(), std::runtime_error);
+}
@@ -0,0 +1,79 @@
+#include "testentities.hpp"
+#include <array>
+#include <gtest/gtest.h>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <scopefntuple.hpp>
+
+using namespace scopefn;
+
+TEST(ScopeFunctionTupleTests, AlsoAllTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    Point point{.x = 1, .y = 2};
+    std::string text = "text";
+
+    auto reset = [](auto& it)
+    {
+        if constexpr (requires { it.clear(); })
+            it.clear();
+        else
+            it = {};
+    };
+    std::tie(person.name, point, text) | also_all(reset);
+    ASSERT_EQ(person.name, "");
+    ASSERT_EQ(point.x, 0);
+    ASSERT_EQ(text, "");
+
+    std::pair<int, long> numbers{1, 2};
+    auto& same = numbers | also_all([](auto& it) { it *= 10; });
+    ASSERT_EQ(&same, &numbers);
+    ASSERT_EQ(numbers.first, 10);
+    ASSERT_EQ(numbers.second, 20);
+
+    // Elements are visited in order
+    std::string order;
+    std::make_tuple('a', 1, std::string("b")) | also_all([&order](const auto& it)
+    {
+        if constexpr (std::is_same_v<std::decay_t<decltype(it)>, int>)
+            order += std::to_string(it);
+        else
+            order += it;
+    });
+    ASSERT_EQ(order, "a1b");
+
+    static_assert((std::array<int, 3>{1, 2, 3} | also_all([](int& it) { it++; }))[2] == 4);
+    static_assert(noexcept(numbers | also_all([](auto&) noexcept {})));
+}
+
+TEST(ScopeFunctionTupleTests, LetAllTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    std::string text = "text";
+    auto [nameLength, textLength] = std::tie(person.name, text) | let_all([](std::string& it) { return it.size(); });
+    ASSERT_EQ(nameLength, 5);
+    ASSERT_EQ(textLength, 4);
+
+    auto sizes = std::make_tuple(std::string("ab"), std::array<int, 3>{}) | let_all([](auto& it) { return it.size(); });
+    static_assert(std::is_same_v<decltype(sizes), std::tuple<size_t, size_t>>);
+    ASSERT_EQ(sizes, std::make_tuple(2, 3));
+
+    // Elements of temporary tuples can be moved out
+    std::tuple<std::string> moved = std::make_tuple(std::string("a long string that is not in the small buffer"))
+        | let_all([](std::string&& it) { return std::move(it); });
+    ASSERT_EQ(std::get<0>(moved), "a long string that is not in the small buffer");
+}
+
+TEST(ScopeFunctionTupleTests, ChainTest)
+{
+    std::optional<std::pair<int, int>> bounds{{1, 5}};
+    std::optional<int> width = bounds
+        | also_all([](int& it) { it *= 2; })
+        | let([](std::pair<int, int>& it) { return it.second - it.first; });
+    ASSERT_EQ(width, 8);
+
+    std::optional<std::pair<int, int>> empty;
+    ASSERT_FALSE(empty | also_all([](int& it) { it = 0; }));
+}
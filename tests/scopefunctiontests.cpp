@@ -1,8 +1,12 @@
 #include "testentities.hpp"
 #include <algorithm>
+#include <array>
+#include <functional>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <gtest/internal/gtest-port.h>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <scopefnmacros.hpp>
 
@@ -66,6 +70,33 @@ TEST(ScopeFunctionTests, WithFunctionTest)
     ASSERT_EQ(person.name, "");
     ASSERT_EQ(person.age, 20);
     ASSERT_EQ(person.location, "London");
+
+    unsigned age = with([self = &person] { return self->age; });
+    ASSERT_EQ(age, 20);
+}
+
+TEST(ScopeFunctionTests, WithMultipleObjectsTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    Point point{.x = 1, .y = 2};
+    std::string log;
+
+    with(person, point, log, [](Person& p, Point& pt, std::string& out)
+    {
+        p.age += pt.x;
+        pt.y = 0;
+        out = p.name;
+    });
+    ASSERT_EQ(person.age, 21);
+    ASSERT_EQ(point.y, 0);
+    ASSERT_EQ(log, "Alice");
+
+    std::string location = with(person, &Person::location);
+    ASSERT_EQ(location, "London");
+    ASSERT_EQ(with(Point{.x = 3, .y = 4}, [](Point&& it) { return it.x * it.y; }), 12);
+    static_assert(with(2, 3, [](int a, int b) { return a * b; }) == 6);
+    static_assert(noexcept(with(person, [](Person&) noexcept { return 1; })));
+    static_assert(!noexcept(with(person, [](Person& it) { return it.name; })));
 }
 
 TEST(ScopeFunctionTests, AlsoFunctionTest)
@@ -132,4 +163,473 @@ TEST(ScopeFunctionTests, CrazyMacrosTest)
     ASSERT_EQ(person.name, "");
     ASSERT_EQ(person.age, 8);
     ASSERT_EQ(person.location, "");
-}
\ No newline at end of file
+}
+
+TEST(ScopeFunctionTests, FreestandingStorageTest)
+{
+    std::array<int, 64> weights{};
+    weights.fill(1);
+    auto sumWeights = [weights](std::vector<int>& it)
+    {
+        for(int w : weights)
+            it.push_back(w);
+    };
+    static_assert(sizeof(also<decltype(sumWeights)>) == sizeof(sumWeights),
+                  "Freestanding `also` must store the lambda without overhead");
+
+    auto vec = std::vector<int>{};
+    size_t size = vec | also(sumWeights)
+                      | let([](std::vector<int>& it) { return it.size(); });
+    ASSERT_EQ(size, 64);
+}
+
+
+namespace
+{
+unsigned doubled(unsigned& it) { return it * 2; }
+
+struct Describe
+{
+    std::string operator()(Person& it) const { return it.name; }
+    std::string operator()(std::vector<int>& it) const { return std::to_string(it.size()); }
+};
+} // namespace
+
+TEST(ScopeFunctionTests, CallableReflectionTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    unsigned age = person.also([](auto& it) { it.age++; })
+                         .also(&Person::incrementAge)
+                         .let([](auto& it) { return it.age; });
+    ASSERT_EQ(age, 22);
+
+    person | also(&Person::incrementAge);
+    ASSERT_EQ(person.age, 23);
+
+    unsigned twice = person | let([](auto& it) { return it.age; }) | let(doubled);
+    ASSERT_EQ(twice, 46);
+
+    auto vec = std::vector<int>{1, 2, 3};
+    ASSERT_EQ(person.let(Describe{}), "Alice");
+    ASSERT_EQ(vec | let(Describe{}), "3");
+
+    Person* pointer = &person;
+    ASSERT_EQ(pointer | let(&Person::age), 23);
+    ASSERT_EQ(std::ref(person) | also(&Person::incrementAge) | let(&Person::age), 24);
+}
+
+TEST(ScopeFunctionTests, MoveThroughChainTest)
+{
+    CopyCounter::reset();
+    CopyCounter counter = CopyCounter{}
+        | let([](CopyCounter&& it) { it.value++; return std::move(it); })
+        | also([](CopyCounter& it) { it.value++; })
+        | let([](CopyCounter&& it) { it.value++; return std::move(it); });
+    ASSERT_EQ(counter.value, 3);
+    ASSERT_EQ(CopyCounter::copies, 0);
+    ASSERT_EQ(CopyCounter::moves, 2);
+
+    CopyCounter::reset();
+    CopyCounter member = CopyCounter{}
+        .apply([] {})
+        .also([](CopyCounter& it) { it.value++; })
+        .let([](CopyCounter&& it) { return std::move(it); });
+    ASSERT_EQ(member.value, 1);
+    ASSERT_EQ(CopyCounter::copies, 0);
+    ASSERT_EQ(CopyCounter::moves, 1);
+
+    CopyCounter::reset();
+    CopyCounter lvalue;
+    lvalue | also([](CopyCounter& it) { it.value++; })
+           | let([](CopyCounter& it) { return it.value; });
+    ASSERT_EQ(lvalue.value, 1);
+    ASSERT_EQ(CopyCounter::copies, 0);
+    ASSERT_EQ(CopyCounter::moves, 0);
+
+    std::vector<int> vec = std::vector<int>{1, 2, 3}
+        | let([](std::vector<int>&& it) { it.push_back(4); return std::move(it); })
+        | also([](std::vector<int>& it) { it.push_back(5); });
+    ASSERT_EQ(vec.size(), 5);
+}
+
+TEST(ScopeFunctionTests, PipelineTest)
+{
+    auto older = also([](Person& it) { it.incrementAge(); })
+               | also(&Person::incrementAge)
+               | let([](Person& it) { return it.age; });
+
+    std::vector<Person> people(3, Person{.name = "Alice", .location = "London", .age = 20});
+    unsigned total = 0;
+    for(auto& person : people)
+        total += person | older;
+    ASSERT_EQ(total, 66);
+    ASSERT_EQ(people[0].age, 22);
+
+    auto sizeTwice = let([](std::vector<int>&& it) { it.push_back(4); return std::move(it); })
+                   | (let([](std::vector<int>& it) { return it.size(); })
+                   | also([](size_t& it) { it *= 2; }));
+    size_t size = std::vector<int>{1, 2, 3} | sizeTwice;
+    ASSERT_EQ(size, 8);
+
+    bool ran = false;
+    auto runStage = run([&ran] { ran = true; return 1; }) | let([](int& it) { return it + 1; });
+    ASSERT_EQ(std::string("hello") | runStage, 2);
+    ASSERT_EQ(ran, true);
+
+    CopyCounter::reset();
+    auto touch = also([](CopyCounter& it) { it.value++; }) | also([](CopyCounter& it) { it.value++; });
+    CopyCounter counter;
+    counter | touch | touch;
+    ASSERT_EQ(counter.value, 4);
+    ASSERT_EQ(CopyCounter::copies, 0);
+    ASSERT_EQ(CopyCounter::moves, 0);
+}
+
+namespace
+{
+constexpr Point makePoint()
+{
+    return Point{}
+        .also([](Point& it) { it.x = 1; })
+        .apply([] {})
+        .let([](Point&& it) { it.y = 2; return std::move(it); });
+}
+
+constexpr auto squarePlusOne = let([](int& it) { return it * it; })
+                             | let([](int& it) { return it + 1; });
+
+consteval int scaledLookup(int index)
+{
+    return index | also([](int& it) { it += 1; })
+                 | let([](int& it) { return it * 10; });
+}
+
+constexpr std::array<int, 4> squareTable = []
+{
+    std::array<int, 4> table{};
+    for(int i = 0; i < 4; i++)
+        table[i] = i | squarePlusOne;
+    return table;
+}();
+} // namespace
+
+TEST(ScopeFunctionTests, ConstexprTest)
+{
+    static_assert(makePoint().x == 1 && makePoint().y == 2);
+    static_assert((3 | squarePlusOne) == 10);
+    static_assert(scaledLookup(4) == 50);
+    static_assert(squareTable[0] == 1 && squareTable[3] == 10);
+    static_assert(Point{}.run([] { return 7; }) == 7);
+    static_assert([]
+    {
+        int value = 0;
+        with([&value] { value = 5; });
+        return value | run([&value] { return value * 2; });
+    }() == 10);
+
+    int runtime = 3;
+    ASSERT_EQ(runtime | squarePlusOne, 10);
+}
+
+TEST(ScopeFunctionTests, NoexceptPropagationTest)
+{
+    auto addOne = [](int& it) noexcept { return it + 1; };
+    auto twice = [](int& it) noexcept { it *= 2; };
+    auto mayThrow = [](int& it)
+    {
+        if(it < 0)
+            throw std::invalid_argument("negative");
+        return it;
+    };
+
+    auto nothrowPipeline = let(addOne) | also(twice) | let(addOne);
+    auto throwingPipeline = let(addOne) | let(mayThrow) | also(twice);
+    static_assert(noexcept(1 | nothrowPipeline));
+    static_assert(std::is_nothrow_invocable_v<decltype(nothrowPipeline)&, int>);
+    static_assert(std::is_nothrow_invocable_v<const decltype(nothrowPipeline)&, int&>);
+    static_assert(!noexcept(1 | throwingPipeline));
+    static_assert(!std::is_nothrow_invocable_v<decltype(throwingPipeline)&, int>);
+
+    int value = 1;
+    static_assert(noexcept(value | also(twice) | let(addOne)));
+    static_assert(!noexcept(value | also(twice) | let(mayThrow)));
+
+    auto vec = std::vector<int>{1, 2, 3};
+    auto grow = [](std::vector<int>& it) noexcept { it.reserve(4); };
+    static_assert(noexcept(vec | (also(grow) | also(grow))));
+
+    Point point;
+    auto moveX = [](Point& it) noexcept { it.x++; };
+    static_assert(noexcept(point.also(moveX).apply([]() noexcept {}).let([](Point& it) noexcept { return it.x; })));
+    static_assert(!noexcept(point.also(moveX).apply([] {})));
+    static_assert(noexcept(Point{}.also(moveX).let([](Point&& it) noexcept { return std::move(it); })));
+
+    ASSERT_EQ(1 | nothrowPipeline, 5);
+    ASSERT_THROW(-2 | throwingPipeline, std::invalid_argument);
+}
+
+TEST(ScopeFunctionTests, TracingTest)
+{
+    RecordingTracer::reset();
+    auto moveX = [](TracedPoint& it) { it.x++; };
+    int x = TracedPoint{}.also(moveX)
+                         .apply([] {})
+                         .also(moveX)
+                         .let([](TracedPoint& it) { return it.x; });
+    ASSERT_EQ(x, 2);
+    ASSERT_EQ(RecordingTracer::calls.size(), 4);
+    ASSERT_EQ(RecordingTracer::calls[0].function, "also");
+    ASSERT_EQ(RecordingTracer::calls[1].function, "apply");
+    ASSERT_EQ(RecordingTracer::calls[3].function, "let");
+    ASSERT_EQ(RecordingTracer::calls[0].id, RecordingTracer::calls[2].id);
+    ASSERT_NE(RecordingTracer::calls[0].id, RecordingTracer::calls[3].id);
+    ASSERT_EQ(RecordingTracer::depth, 0);
+
+    RecordingTracer::reset();
+    RecordingTracer tracer;
+    int value = 1;
+    auto stages = also_traced(tracer, [](int& it) { it *= 2; }) | let_traced(tracer, [](int& it) { return it + 1; });
+    ASSERT_EQ(value | stages, 3);
+    ASSERT_EQ(value, 2);
+    ASSERT_EQ(RecordingTracer::calls.size(), 2);
+    ASSERT_EQ(RecordingTracer::calls[1].function, "let");
+
+    auto nested = TracedPoint{}.let([](TracedPoint&& it) { return it.run([] { return 1; }); });
+    ASSERT_EQ(nested, 1);
+    ASSERT_EQ(RecordingTracer::calls.back().depth, 1);
+
+    RecordingTracer::reset();
+    ASSERT_THROW(TracedPoint{}.also([](TracedPoint&) { throw std::runtime_error("failed"); }), std::runtime_error);
+    ASSERT_EQ(RecordingTracer::depth, 0);
+
+    // Tracing with NoTracer adds no state and keeps the lambda noexcept
+    auto untraced = also_traced(NoTracer{}, [](int& it) noexcept { it++; });
+    static_assert(noexcept(value | untraced));
+    static_assert(sizeof(TracedPoint) == sizeof(Point));
+}
+
+TEST(ScopeFunctionTests, TakeIfTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+    auto adult = [](Person& it) { return it.age >= 18; };
+
+    optional_ref<Person> taken = person.take_if(adult);
+    ASSERT_TRUE(taken.has_value());
+    ASSERT_EQ(&*taken, &person);
+    ASSERT_FALSE(person.take_unless(adult));
+
+    std::optional<std::string> name = person | take_if(adult) | let([](Person& it) { return it.name; });
+    ASSERT_EQ(name, "Alice");
+    std::optional<std::string> none = person | take_unless(adult) | let([](Person& it) { return it.name; });
+    ASSERT_FALSE(none.has_value());
+
+    unsigned calls = 0;
+    person | take_unless(adult) | also([&calls](Person&) { calls++; });
+    ASSERT_EQ(calls, 0);
+    person | take_if(adult) | also(&Person::incrementAge) | also([&calls](Person&) { calls++; });
+    ASSERT_EQ(calls, 1);
+    ASSERT_EQ(person.age, 21);
+
+    // Consecutive filters and pipelines short-circuit too
+    auto inLondon = take_if([](Person& it) { return it.location == "London"; })
+                  | take_if([](Person& it) { return it.name == "Bob"; })
+                  | let([](Person& it) { return it.age; });
+    std::optional<unsigned> age = person | inLondon;
+    ASSERT_FALSE(age.has_value());
+
+    // The context object is referenced, never copied
+    CopyCounter::reset();
+    CopyCounter counter;
+    counter.value = 3;
+    optional_ref<CopyCounter> odd = counter
+        | take_if([](CopyCounter& it) { return it.value % 2 == 1; })
+        | also([](CopyCounter& it) { it.value++; });
+    ASSERT_EQ(odd->value, 4);
+    ASSERT_EQ(CopyCounter::copies + CopyCounter::moves, 0);
+
+    static_assert(Point{}.take_unless([](Point& it) { return it.x != 0; }).has_value());
+    static_assert([]
+    {
+        int value = 4;
+        return (value | take_if([](int it) { return it > 3; }) | let([](int& it) { return it * 2; })).value_or(0);
+    }() == 8);
+}
+
+TEST(ScopeFunctionTests, OptionalShortCircuitTest)
+{
+    auto parse = [](const std::string& it) -> std::optional<int>
+    {
+        if(it.empty() || it.find_first_not_of("0123456789") != std::string::npos)
+            return std::nullopt;
+        return std::stoi(it);
+    };
+    unsigned calls = 0;
+    auto stages = let([&calls](int it) { calls++; return it * 2; })
+                | also([&calls](int&) { calls++; })
+                | let([](int it) { return std::to_string(it); });
+
+    std::optional<std::string> doubled = parse("21") | stages;
+    ASSERT_EQ(doubled, "42");
+    ASSERT_EQ(calls, 2);
+
+    std::optional<std::string> skipped = parse("x") | stages;
+    ASSERT_FALSE(skipped.has_value());
+    ASSERT_EQ(calls, 2);
+
+    // Stages returning optionals are flattened, so any stage can fail
+    std::optional<int> flattened = std::optional<std::string>("7") | let(parse) | let([](int it) { return it + 1; });
+    ASSERT_EQ(flattened, 8);
+
+    // The payload is moved between stages, also keeps the optional itself
+    CopyCounter::reset();
+    std::optional<CopyCounter> counter = std::optional<CopyCounter>(std::in_place)
+        | also([](CopyCounter& it) { it.value = 5; })
+        | let([](CopyCounter&& it) { return std::move(it); });
+    ASSERT_EQ(counter->value, 5);
+    ASSERT_EQ(CopyCounter::copies, 0);
+
+    std::optional<Person> person = Person{.name = "Alice", .location = "London", .age = 20};
+    std::optional<Person>& same = person | also(&Person::incrementAge);
+    ASSERT_EQ(&same, &person);
+    ASSERT_EQ(person->age, 21);
+    std::optional<std::string> name = person | let([](Person& it) { return it.name; });
+    ASSERT_EQ(name, "Alice");
+
+    static_assert((std::optional<int>(3) | let([](int it) { return it * 3; })).value() == 9);
+    static_assert(!(std::optional<int>() | let([](int it) { return it * 3; })).has_value());
+}
+
+TEST(ScopeFunctionTests, WrapperStageTest)
+{
+    // Stages taking the optional itself, and generic lambdas, receive it as it
+    // is, even when it is empty, like before chains short-circuited
+    std::optional<int> empty;
+    bool hasValue = empty | let([](std::optional<int>& it) { return it.has_value(); });
+    ASSERT_FALSE(hasValue);
+    bool generic = empty | let([](auto& it) { return it.has_value(); });
+    ASSERT_FALSE(generic);
+    unsigned calls = 0;
+    empty | also([&calls](const std::optional<int>&) { calls++; })
+          | run([&calls] { calls++; });
+    ASSERT_EQ(calls, 2);
+
+    std::optional<int> fallback = std::optional<int>()
+        | let([](std::optional<int>&& it) { return it.value_or(5); })
+        | let([](int it) { return it * 2; });
+    ASSERT_EQ(fallback, 10);
+    auto stages = let([](std::optional<int>& it) { return it.value_or(1); }) | let([](int it) { return it + 1; });
+    static_assert(std::is_same_v<decltype(empty | stages), int>);
+    ASSERT_EQ(empty | stages, 2);
+
+#if __cpp_lib_expected
+    std::expected<int, std::string> failed = std::unexpected("failed");
+    std::string error = failed | let([](std::expected<int, std::string>& it) { return it.error(); });
+    ASSERT_EQ(error, "failed");
+#endif
+}
+
+#if __cpp_lib_expected
+TEST(ScopeFunctionTests, ExpectedShortCircuitTest)
+{
+    auto parse = [](const std::string& it) -> std::expected<int, std::string>
+    {
+        if(it.empty() || it.find_first_not_of("0123456789") != std::string::npos)
+            return std::unexpected("not a number: " + it);
+        return std::stoi(it);
+    };
+    unsigned calls = 0;
+    auto stages = let(parse)
+                | also([&calls](int&) { calls++; })
+                | let([](int it) { return it * 2; });
+
+    std::expected<int, std::string> doubled = std::string("21") | stages;
+    ASSERT_EQ(doubled.value(), 42);
+    std::expected<int, std::string> failed = std::string("x") | stages;
+    ASSERT_EQ(failed.error(), "not a number: x");
+    ASSERT_EQ(calls, 1);
+
+    CopyCounter::reset();
+    std::expected<CopyCounter, int> counter = std::expected<CopyCounter, int>(std::in_place)
+        | also([](CopyCounter& it) { it.value = 5; })
+        | let([](CopyCounter&& it) { return std::move(it); });
+    ASSERT_EQ(counter->value, 5);
+    ASSERT_EQ(CopyCounter::copies, 0);
+
+    std::expected<void, int> checked = std::expected<int, int>(std::unexpect, 3) | let([](int) {});
+    ASSERT_EQ(checked.error(), 3);
+}
+#endif
+
+TEST(ScopeFunctionTests, ConstCorrectnessTest)
+{
+    const Person person{.name = "Alice", .location = "London", .age = 20};
+    std::string log;
+
+    unsigned age = person.also([&log](const Person& it) { log = it.name; })
+                         .apply([] {})
+                         .let([](const Person& it) { return it.age; });
+    ASSERT_EQ(age, 20);
+    ASSERT_EQ(log, "Alice");
+    ASSERT_EQ(person.run([] { return 1; }), 1);
+
+    optional_ref<const Person> adult = person.take_if([](const Person& it) { return it.age >= 18; });
+    ASSERT_EQ(&*adult, &person);
+    ASSERT_FALSE(person.take_unless([](auto& it) { return it.age >= 18; }));
+
+    const std::vector<int> shared{1, 2, 3};
+    int sum = shared | also([](const std::vector<int>& it) { ASSERT_EQ(it.size(), 3); })
+                     | let([](const std::vector<int>& it) { return it[0] + it[1] + it[2]; });
+    ASSERT_EQ(sum, 6);
+    const std::vector<int>& same = shared | also([](auto& it) { ASSERT_EQ(it[0], 1); });
+    ASSERT_EQ(&same, &shared);
+
+    // Read-only chains on const objects never copy them
+    CopyCounter::reset();
+    const CopyCounter counter;
+    int value = counter.also([](const CopyCounter&) {})
+                       .let([](const CopyCounter& it) { return it.value; });
+    value += (counter | take_if([](const CopyCounter& it) { return it.value == 0; })
+                      | let([](const CopyCounter& it) { return it.value + 1; })).value_or(0);
+    ASSERT_EQ(value, 1);
+    ASSERT_EQ(CopyCounter::copies + CopyCounter::moves, 0);
+
+    static_assert(std::is_same_v<decltype(person.also([](const Person&) {})), const Person&>);
+    static_assert(std::is_same_v<decltype(shared | take_if([](auto&) { return true; })),
+                                 optional_ref<const std::vector<int>>>);
+}
+
+TEST(ScopeFunctionTests, ProjectionTest)
+{
+    Person person{.name = "Alice", .location = "London", .age = 20};
+
+    // Pointers to members are invoked on the context object by run and apply
+    person.apply(&Person::incrementAge).apply(&Person::incrementAge);
+    ASSERT_EQ(person.age, 22);
+    ASSERT_EQ(person.run(&Person::age), 22);
+    const Person& constPerson = person;
+    ASSERT_EQ(constPerson.run(&Person::name), "Alice");
+    ASSERT_EQ(person.apply(member<&Person::incrementAge>{}).run(member<&Person::age>{}), 23);
+    ASSERT_EQ(person | let(member<&Person::age>{}), 23);
+    person.age = 22;
+
+    // Projections select the part of the context object passed to the lambda
+    size_t length = person | let(&Person::name, [](std::string& it) { return it.size(); });
+    ASSERT_EQ(length, 5);
+    Person& same = person | also(&Person::location, [](std::string& it) { it = "Paris"; })
+                          | also(&Person::age, [](unsigned& it) { it++; });
+    ASSERT_EQ(&same, &person);
+    ASSERT_EQ(person.location, "Paris");
+    ASSERT_EQ(person.age, 23);
+
+    auto initial = [](const Person& it) { return it.name.front(); };
+    ASSERT_EQ(person | let(initial, [](char it) { return it == 'A'; }), true);
+
+    // Temporaries are projected as rvalues, so their members can be moved out
+    std::string name = Person{.name = "a long name that is not in the small buffer"}
+        | let(&Person::name, [](std::string&& it) { return std::move(it); });
+    ASSERT_EQ(name, "a long name that is not in the small buffer");
+
+    auto lambda = [](unsigned& it) { it++; };
+    static_assert(sizeof(also<decltype(lambda)>) == sizeof(lambda));
+    static_assert((Point{.x = 2, .y = 5} | let(&Point::y, [](int it) { return it * 2; })) == 10);
+}
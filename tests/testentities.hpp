@@ -12,6 +12,7 @@ struct Person : scopefn::ScopeFunctions<Person>
     std::string location;
     unsigned age;
     void moveTo(std::string newLocation) { location = newLocation; }
+    void incrementAge() { age++; }
 
     bool operator==(Person& other)
     {
@@ -21,4 +22,67 @@ struct Person : scopefn::ScopeFunctions<Person>
     }
 };
 
+/**
+ * @brief Literal type used to check that scope functions work in constant
+ * expressions.
+ */
+struct Point : scopefn::ScopeFunctions<Point>
+{
+    int x = 0;
+    int y = 0;
+};
+
+/**
+ * @brief Counts how many times it was copied or moved, to verify that scope
+ * function chains move temporaries through instead of copying them.
+ */
+struct CopyCounter : scopefn::ScopeFunctions<CopyCounter>
+{
+    static inline unsigned copies = 0;
+    static inline unsigned moves = 0;
+    static void reset() { copies = 0; moves = 0; }
+
+    int value = 0;
+
+    CopyCounter() = default;
+    CopyCounter(const CopyCounter& other) : value(other.value) { copies++; }
+    CopyCounter(CopyCounter&& other) noexcept : value(other.value) { moves++; }
+    CopyCounter& operator=(const CopyCounter& other) { value = other.value; copies++; return *this; }
+    CopyCounter& operator=(CopyCounter&& other) noexcept { value = other.value; moves++; return *this; }
+};
+
+/**
+ * @brief Tracer recording the traced scope function calls in order, shared
+ * by all instances so it can be used as a ScopeFunctions tracer policy.
+ */
+struct RecordingTracer
+{
+    struct Call
+    {
+        std::string function;
+        const void* id;
+        unsigned depth;
+    };
+
+    static inline std::vector<Call> calls;
+    static inline unsigned depth = 0;
+    static void reset() { calls.clear(); depth = 0; }
+
+    unsigned begin(scopefn::stage_info info)
+    {
+        calls.push_back({info.function, info.id, depth});
+        return depth++;
+    }
+    void end(scopefn::stage_info, unsigned started) { depth = started; }
+};
+
+/**
+ * @brief Entity whose scope methods are traced by RecordingTracer.
+ */
+struct TracedPoint : scopefn::ScopeFunctions<TracedPoint, RecordingTracer>
+{
+    int x = 0;
+    int y = 0;
+};
+
 #endif
\ No newline at end of file